@@ -1,4 +1,5 @@
 #include "OTA_Init.h"
+#include "otamode.h"
 
 // My standard OTA initialization routing
 
@@ -27,17 +28,21 @@ void OTA_Init() {
 
       // NOTE: if updating SPIFFS this would be the place to unmount SPIFFS using SPIFFS.end()
       Serial.println("Start updating " + type);
+      otaModeBegin(OTA_SRC_ARDUINO);
     });
 
     ArduinoOTA.onEnd([]() {
       Serial.println("\nEnd");
+      otaModeEnd(true);
     });
 
     ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
       Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
+      otaModeProgress(progress);
     });
 
     ArduinoOTA.onError([](ota_error_t error) {
+      otaModeEnd(false);
       Serial.printf("Error[%u]: ", error);
       if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
       else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
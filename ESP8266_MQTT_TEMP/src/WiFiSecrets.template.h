@@ -18,9 +18,15 @@
 #define SECRET_SSID "Your-Network-SSID"
 #define SECRET_PASS "Your-Network-Passcode"
 
-// alternate SSID optional for WiFiMulti library
+// alternate SSIDs optional - the strongest AP of any of them is joined
 //#define SECRET_SSID1 "Your-alternate-SSID"
 //#define SECRET_PASS1 "Your-alternate-Passcode"
+//#define SECRET_SSID2 "Your-second-alternate-SSID"
+//#define SECRET_PASS2 "Your-second-alternate-Passcode"
+
+// always-on nodes look for a stronger AP below this RSSI
+#define WIFI_ROAM_RSSI -75      // dBm
+#define WIFI_ROAM_MARGIN 8      // dB stronger than the current AP
 
 // OTA Password
 #define SECRET_OTA_PASS "protoNR4O"
@@ -35,12 +41,47 @@
 #define PRIMARY_DNS_IP "Primary-DNS-IP"
 #define SECONDARY_DNS_IP "Secondary-DNS-IP"
 
+// SNTP server used to timestamp the on-flash history
+#define NTP_SERVER "pool.ntp.org"
+
 // MQTT IP Address and port
 #define MQTT_ENABLED "f"  // enable MQTT "t" or "f" in quotes
-#define MQTT_SERVER_IP "Your-MQTT-Server-IP"
-#define MQTT_PORT 1883    // default MQTT port - integer type
+#define MQTT_SERVER_IP "Your-MQTT-Server-IP"  // IP, host name, or "" to find
+                                              // the broker by mDNS (_mqtt._tcp)
+#define BROKER_CACHE_TTL_SEC 3600UL // keep a looked up address this long
+#define MQTT_PORT 1883    // default MQTT port - integer type, 8883 for TLS
 #define MQTT_SECURE_ENABLE "f"  //secure MQTT "t" or "f" in quotes
+// broker verification for TLS - a CA certificate, else the SHA1
+// fingerprint of the broker certificate, else none (warning at connect)
+#define MQTT_TLS_FINGERPRINT ""  // "AA:BB:..." from openssl x509 -fingerprint
+//#define MQTT_CA_CERT R"EOF(
+//-----BEGIN CERTIFICATE-----
+//...
+//-----END CERTIFICATE-----
+//)EOF"
 #define MQTT_USER ""      // default null or none
 #define MQTT_PASSWORD ""  // default null or none
+#define MQTT_CLEAN_SESSION "t"  // "f" = durable session kept across wakes
+#define MQTT_PUBLISH_QOS 1      // 0 or 1 for the sensor readings
+
+// Replay rate of messages spooled to flash while the broker was down
+#define SPOOL_BATCH_SIZE 10       // messages per batch
+#define SPOOL_REPLAY_MS 1000UL    // milliseconds between batches
+
+// Battery calibration for the 100K/540K divider on A0
+// measure the battery with a meter and adjust to match the reading
+#define BATTERY_CAL_SCALE (5.15f / 1024)  // volts per A0 step
+#define BATTERY_CAL_OFFSET 0.0f           // volts added after scaling
+
+// Adaptive sampling - intervals shrink while temperatures are moving
+#define ADAPT_THRESHOLD 10          // 1/100 degC per minute that halves the interval
+#define ADAPT_AWAKE_MIN_MS 2000UL   // sample interval bounds while awake
+#define ADAPT_AWAKE_MAX_MS 30000UL
+#define ADAPT_SLEEP_MIN_SEC 60UL    // deep sleep interval bounds
+#define ADAPT_SLEEP_MAX_SEC 1800UL
+
+// Status messages are only sent in full when their content changed
+#define STATUS_HEARTBEAT_SEC 300UL  // message count only, when unchanged
+#define STATUS_REFRESH_SEC 1800UL   // full status even when unchanged
 
 #endif
@@ -1,4 +1,5 @@
 #include "WiFi_Init.h"
+#include "wifiap.h"
 
 Config config;  // instantiate the configuration struct
 Status status;  // instantiate the status struct
@@ -79,11 +80,13 @@ bool WiFi_Init() {
   #endif
 
   unsigned long wifiStart = millis();
-  WiFi.begin(config.ssid, config.pw);
+  // the AP of the last wake, else the strongest AP found by a scan
+  wifiApBegin(true);
   while (WiFi.status() != WL_CONNECTED) {
     // check for timeout
       delay(500);
       Serial.print(".");
+      wifiApFastJoin();   // scan if the cached AP does not answer
 
     if (millis() - wifiStart > config.wifiTimeout) {
       Serial.printf("...ERROR - Connection Timeout - %lumS...\n", millis() - wifiStart);
@@ -97,6 +100,7 @@ bool WiFi_Init() {
   // print how long it took to connect
   Serial.printf("%lumS\n", millis() - wifiStart);
   wifiConnected = true;
+  wifiApConnected();      // log the AP and cache it for the next wake
 
   // Generate a Hostname for this device based on status.host plus the last byte of the MAC address
   strcpy(status.host, rootHostname);  // set the root string for status.host
@@ -186,6 +190,8 @@ const char *wl_status_to_string(wl_status_t status)
       return "WL_CONNECT_FAILED";
     case WL_CONNECTION_LOST:
       return "WL_CONNECTION_LOST";
+    case WL_WRONG_PASSWORD:
+      return "WL_WRONG_PASSWORD";
     case WL_DISCONNECTED:
       return "WL_DISCONNECTED";
     default:
@@ -251,7 +257,14 @@ void loadConfiguration(Config &config) {
           SECRET_PASS,                  // <- source
           sizeof(config.pw));           // <- destination's capacity
 
+  strncpy(config.ssid1, SECRET_SSID1, sizeof(config.ssid1));
+  strncpy(config.pw1, SECRET_PASS1, sizeof(config.pw1));
+  strncpy(config.ssid2, SECRET_SSID2, sizeof(config.ssid2));
+  strncpy(config.pw2, SECRET_PASS2, sizeof(config.pw2));
+
   config.wifiTimeout = WIFI_TIMEOUT;
+  config.wifiRoamRssi = WIFI_ROAM_RSSI;
+  config.wifiRoamMargin = WIFI_ROAM_MARGIN;
 
   strncpy(config.mqttEnable,                  // <- destination
           MQTT_ENABLED,                       // <- source
@@ -289,6 +302,33 @@ void loadConfiguration(Config &config) {
   strncpy(config.staticSecondaryDNSAddress,         // <- destination
           SECONDARY_DNS_IP,                         // <- source
           sizeof(config.staticSecondaryDNSAddress));// <- destination's capacity
+  strncpy(config.ntpServer,                         // <- destination
+          NTP_SERVER,                               // <- source
+          sizeof(config.ntpServer));                // <- destination's capacity
+
+  strncpy(config.mqttFingerprint,                   // <- destination
+          MQTT_TLS_FINGERPRINT,                     // <- source
+          sizeof(config.mqttFingerprint));          // <- destination's capacity
+  strncpy(config.mqttCleanSession,                  // <- destination
+          MQTT_CLEAN_SESSION,                       // <- source
+          sizeof(config.mqttCleanSession));         // <- destination's capacity
+  config.mqttQos = MQTT_PUBLISH_QOS;
+  config.brokerTtl = BROKER_CACHE_TTL_SEC;
+
+  config.spoolBatch = SPOOL_BATCH_SIZE;
+  config.spoolInterval = SPOOL_REPLAY_MS;
+
+  config.batteryScale = BATTERY_CAL_SCALE;
+  config.batteryOffset = BATTERY_CAL_OFFSET;
+
+  config.adaptThreshold = ADAPT_THRESHOLD;
+  config.adaptAwakeMinMs = ADAPT_AWAKE_MIN_MS;
+  config.adaptAwakeMaxMs = ADAPT_AWAKE_MAX_MS;
+  config.adaptSleepMinSec = ADAPT_SLEEP_MIN_SEC;
+  config.adaptSleepMaxSec = ADAPT_SLEEP_MAX_SEC;
+
+  config.statusHeartbeat = STATUS_HEARTBEAT_SEC;
+  config.statusRefresh = STATUS_REFRESH_SEC;
 
 }
 /*  ++++++ Don't need all the JsonDocument stuff yet ++++++++++
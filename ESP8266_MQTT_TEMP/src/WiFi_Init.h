@@ -6,11 +6,81 @@
 #include "WiFiSecrets.h"
 #include <stdlib.h>
 
+// defaults for settings added after WiFiSecrets.h was created
+#ifndef NTP_SERVER
+#define NTP_SERVER "pool.ntp.org"
+#endif
+#ifndef SPOOL_BATCH_SIZE
+#define SPOOL_BATCH_SIZE 10       // spooled messages replayed per batch
+#endif
+#ifndef MQTT_CLEAN_SESSION
+#define MQTT_CLEAN_SESSION "t"    // "f" keeps the broker session across wakes
+#endif
+#ifndef MQTT_PUBLISH_QOS
+#define MQTT_PUBLISH_QOS 1        // QoS of the outTopic readings
+#endif
+#ifndef MQTT_TLS_FINGERPRINT
+#define MQTT_TLS_FINGERPRINT ""   // SHA1 of the broker certificate
+#endif
+#ifndef BATTERY_CAL_SCALE
+#define BATTERY_CAL_SCALE (5.15f / 1024)  // volts per A0 step
+#endif
+#ifndef BATTERY_CAL_OFFSET
+#define BATTERY_CAL_OFFSET 0.0f   // volts added after scaling
+#endif
+#ifndef ADAPT_THRESHOLD
+#define ADAPT_THRESHOLD 10        // 1/100 degC per minute that halves the interval
+#endif
+#ifndef ADAPT_AWAKE_MIN_MS
+#define ADAPT_AWAKE_MIN_MS 2000UL // sample interval bounds while awake
+#endif
+#ifndef ADAPT_AWAKE_MAX_MS
+#define ADAPT_AWAKE_MAX_MS 30000UL
+#endif
+#ifndef ADAPT_SLEEP_MIN_SEC
+#define ADAPT_SLEEP_MIN_SEC 60UL  // deep sleep interval bounds
+#endif
+#ifndef ADAPT_SLEEP_MAX_SEC
+#define ADAPT_SLEEP_MAX_SEC 1800UL
+#endif
+#ifndef STATUS_HEARTBEAT_SEC
+#define STATUS_HEARTBEAT_SEC 300UL  // count only status when nothing changed
+#endif
+#ifndef STATUS_REFRESH_SEC
+#define STATUS_REFRESH_SEC 1800UL   // full status even when nothing changed
+#endif
+#ifndef SECRET_SSID1
+#define SECRET_SSID1 ""             // alternate networks, "" = not used
+#define SECRET_PASS1 ""
+#endif
+#ifndef SECRET_SSID2
+#define SECRET_SSID2 ""
+#define SECRET_PASS2 ""
+#endif
+#ifndef WIFI_ROAM_RSSI
+#define WIFI_ROAM_RSSI -75          // dBm that starts a roaming scan
+#endif
+#ifndef WIFI_ROAM_MARGIN
+#define WIFI_ROAM_MARGIN 8          // dB a new AP must be stronger by
+#endif
+#ifndef BROKER_CACHE_TTL_SEC
+#define BROKER_CACHE_TTL_SEC 3600UL // seconds a resolved broker address is kept
+#endif
+#ifndef SPOOL_REPLAY_MS
+#define SPOOL_REPLAY_MS 1000UL    // minimum time between replay batches
+#endif
+
 //++++++++++++++++++++++
 // WiFi variable definitions
 struct Config {   // configuration parameters
   char ssid[50];
   char pw[50];
+  char ssid1[50];               // alternate networks - see wifiap.h
+  char pw1[50];
+  char ssid2[50];
+  char pw2[50];
+  int wifiRoamRssi;
+  int wifiRoamMargin;
   long unsigned int wifiTimeout;
   char mqttEnable[3];
   int mqttPort;
@@ -18,12 +88,28 @@ struct Config {   // configuration parameters
   char mqttSecureEnable[3];
   char mqttUser[50];
   char mqttPW[50];
+  char mqttFingerprint[60];
+  char mqttCleanSession[3];
+  uint8_t mqttQos;
+  unsigned long brokerTtl;
   char staticIPenable[3];
   char staticIP[20];
   char staticGatewayAddress[20];
   char staticSubnetAddress[20];
   char staticPrimaryDNSAddress[20];
   char staticSecondaryDNSAddress[20];
+  char ntpServer[50];
+  int spoolBatch;
+  unsigned long spoolInterval;
+  float batteryScale;
+  float batteryOffset;
+  uint16_t adaptThreshold;
+  unsigned long adaptAwakeMinMs;
+  unsigned long adaptAwakeMaxMs;
+  unsigned long adaptSleepMinSec;
+  unsigned long adaptSleepMaxSec;
+  unsigned long statusHeartbeat;
+  unsigned long statusRefresh;
 };
 
 struct Status {   // status json parameters
@@ -35,9 +121,10 @@ struct Status {   // status json parameters
   char wifi[15];
   int rssi;
   char relay[10];
-  float DegC[5];
-  float DegF[5];
+  int16_t tempRaw[5];           // DS18B20 readings, 1/16 degC - see fixedpoint.h
+  unsigned int tempErrors[5];   // DS18B20 read errors since boot
   float vcc;
+  int battery;                  // estimated remaining capacity %
   unsigned long runTime;
   unsigned int msgCount;
 };
@@ -0,0 +1,116 @@
+#include "adaptive.h"
+#include "rtcmem.h"
+#include "WiFi_Init.h"
+#include "fixedpoint.h"
+
+extern Config config;  // declare the external configuration struct
+
+static_assert(RTC_ADAPTIVE + RTC_BLOCKS(AdaptiveState) <= RTC_ADAPTIVE_END,
+              "AdaptiveState does not fit its RTC memory slot");
+
+static AdaptiveState state;
+static unsigned long lastSampleMs = 0;        // millis() of the last sample
+static unsigned int lastErrors[ADAPT_CHANNELS];
+
+/*-------------------------------------------------------------------------
+ * Function to load the estimator state carried over deep sleep
+ * - reset starts every channel over, used on power on
+ *-------------------------------------------------------------------------*/
+void adaptiveInit(bool reset) {
+  ESP.rtcUserMemoryRead(RTC_ADAPTIVE, (uint32_t *)&state, sizeof(state));
+  if (reset || state.magic != RTC_ADAPTIVE_MAGIC) {
+    memset(&state, 0, sizeof(state));
+    state.magic = RTC_ADAPTIVE_MAGIC;
+  }
+  lastSampleMs = millis();
+}
+
+static int32_t clamp16(int32_t v) {
+  return v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to feed a new set of readings to the estimator
+ * - resolution is each sensor's bits, the deadband is one step of it
+ * - a channel whose error count moved has no reading; at the end of a
+ *   window it starts over from its next reading
+ *-------------------------------------------------------------------------*/
+void adaptiveUpdate(const int16_t raw[], const unsigned int errors[],
+                    const uint8_t resolution[], int n) {
+  unsigned long now = millis();
+  state.windowMs += now - lastSampleMs;
+  lastSampleMs = now;
+  bool windowEnd = state.windowMs >= ADAPT_WINDOW_MS;
+
+  if (n > ADAPT_CHANNELS) n = ADAPT_CHANNELS;
+  for (int i = 0; i < n; i++) {
+    AdaptiveChannel &c = state.ch[i];
+    bool ok = errors[i] == lastErrors[i] && raw[i] != TEMP_RAW_INVALID;
+    lastErrors[i] = errors[i];
+    if (!ok) {
+      if (windowEnd) c.valid = 0;             // no reading to close it
+      continue;
+    }
+    if (c.valid && !windowEnd) continue;      // rate at the window end
+    if (c.valid) {
+      int bits = resolution[i] < 9 ? 9 : resolution[i] > 12 ? 12 : resolution[i];
+      int32_t delta = raw[i] - c.lastRaw;
+      if (abs(delta) <= (1 << (12 - bits))) delta = 0;  // quantisation
+      // 1/16 degC over windowMs to 1/100 degC per minute
+      int32_t rate = clamp16((int64_t)delta * 25 * 60000 / 4 / (int64_t)state.windowMs);
+      c.slope += (rate - c.slope) >> ADAPT_EWMA_SHIFT;
+      int32_t residual = abs(rate - c.slope);
+      c.dev += (residual - (int32_t)c.dev) >> ADAPT_EWMA_SHIFT;
+    }
+    c.lastRaw = raw[i];
+    c.valid = 1;
+  }
+  if (windowEnd) state.windowMs = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return the activity of the busiest channel
+ * - |slope| + deviation in 1/100 degC per minute
+ *-------------------------------------------------------------------------*/
+uint32_t adaptiveActivity() {
+  uint32_t activity = 0;
+  for (const AdaptiveChannel &c : state.ch) {
+    if (!c.valid) continue;
+    uint32_t a = abs(c.slope) + c.dev;
+    if (a > activity) activity = a;
+  }
+  return activity;
+}
+
+// scale the maximum down by threshold / (threshold + activity)
+static uint32_t adaptiveInterval(uint32_t minimum, uint32_t maximum) {
+  uint32_t threshold = config.adaptThreshold ? config.adaptThreshold : 1;
+  uint64_t interval = (uint64_t)maximum * threshold / (threshold + adaptiveActivity());
+  if (interval < minimum) interval = minimum;
+  return interval;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return the sample interval while awake
+ *-------------------------------------------------------------------------*/
+unsigned long adaptiveAwakeMs() {
+  return adaptiveInterval(config.adaptAwakeMinMs, config.adaptAwakeMaxMs);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return the deep sleep interval
+ *-------------------------------------------------------------------------*/
+uint64_t adaptiveSleepUs() {
+  uint32_t sec = adaptiveInterval(config.adaptSleepMinSec, config.adaptSleepMaxSec);
+  Serial.printf("Activity %u/100 C/min - sleep %us\r\n", adaptiveActivity(), sec);
+  return (uint64_t)sec * 1000000UL;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to save the estimator state before deep sleep
+ * - sleepUs is the interval actually slept, after any battery stretch
+ *-------------------------------------------------------------------------*/
+void adaptiveSleep(uint64_t sleepUs) {
+  state.windowMs += (millis() - lastSampleMs) + (uint32_t)(sleepUs / 1000);
+  ESP.rtcUserMemoryWrite(RTC_ADAPTIVE, (uint32_t *)&state, sizeof(state));
+}
@@ -0,0 +1,48 @@
+#ifndef __ADAPTIVE_H__
+#define __ADAPTIVE_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Adaptive sampling
+// Each channel keeps a smoothed rate of change and the average deviation
+// from it, in 1/100 degC per minute.  The busiest channel sets the next
+// sample interval while awake and the next deep sleep interval: at rest
+// the configured maximum, halved when the activity reaches the configured
+// threshold and shorter still as it grows, never below the minimum.  The
+// estimator state is kept in RTC memory so the slope carries over sleep.
+// A rate is only taken over a window of at least ADAPT_WINDOW_MS, whatever
+// the sample interval, and a change of one sensor step or less counts as
+// none.  A DS18B20 reading dithers by a step on a steady temperature, so
+// a rate from back to back samples would shorten the interval, and the
+// shorter interval would make the next rate larger still.
+#define ADAPT_CHANNELS 5              // MAX_DEVICES
+#define ADAPT_EWMA_SHIFT 2            // weight 1/4 for a new rate
+#define ADAPT_WINDOW_MS 120000UL      // shortest span a rate is taken over
+#define RTC_ADAPTIVE_MAGIC 0x41445032UL // "ADP2"
+
+struct AdaptiveChannel {
+  int16_t lastRaw;                    // reading at the window start, 1/16 degC
+  int16_t slope;                      // smoothed rate, 1/100 degC/min
+  uint16_t dev;                       // smoothed |rate - slope|
+  uint8_t valid;                      // lastRaw holds a reading
+  uint8_t reserved;
+};
+
+struct AdaptiveState {                // kept in RTC memory
+  uint32_t magic;
+  uint32_t windowMs;                  // time since the window start, over sleep
+  AdaptiveChannel ch[ADAPT_CHANNELS];
+};
+
+//++++++++++++++++++++++
+// Forward function declarations
+void adaptiveInit(bool reset);
+void adaptiveUpdate(const int16_t raw[], const unsigned int errors[],
+                    const uint8_t resolution[], int n);
+uint32_t adaptiveActivity();
+unsigned long adaptiveAwakeMs();
+uint64_t adaptiveSleepUs();
+void adaptiveSleep(uint64_t sleepUs);
+
+#endif  // __ADAPTIVE_H__
@@ -0,0 +1,113 @@
+#include "battery.h"
+#include "rtcmem.h"
+#include "WiFi_Init.h"
+
+extern Config config;  // declare the external configuration struct
+
+static_assert(RTC_BATTERY + RTC_BLOCKS(BatteryState) <= RTC_BATTERY_END,
+              "BatteryState does not fit its RTC memory slot");
+
+// single cell Li-ion open circuit voltage to remaining capacity
+struct CapacityPoint {
+  uint16_t mv;
+  uint8_t percent;
+};
+
+static const CapacityPoint capacityCurve[] = {
+  { 4200, 100 }, { 4100, 90 }, { 4000, 78 }, { 3900, 65 }, { 3800, 50 },
+  { 3700, 33 }, { 3600, 18 }, { 3500, 8 }, { 3400, 3 }, { 3300, 0 },
+};
+
+static const BatterySleepStep sleepSteps[] = {
+  { 15, 6 },                      // nearly flat - wake once an hour
+  { 30, 3 },
+  { 50, 2 },
+};
+
+static BatteryState state;
+
+/*-------------------------------------------------------------------------
+ * Function to load the filter state carried over deep sleep
+ * - reset starts the filter over, used on power on
+ *-------------------------------------------------------------------------*/
+void batteryInit(bool reset) {
+  ESP.rtcUserMemoryRead(RTC_BATTERY, (uint32_t *)&state, sizeof(state));
+  if (reset || state.magic != RTC_BATTERY_MAGIC) {
+    state.magic = RTC_BATTERY_MAGIC;
+    state.filteredMv16 = 0;       // seeded by the first reading
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to take an oversampled, calibrated battery reading
+ * - the highest and lowest A0 reads are dropped, the rest averaged
+ * - returns the filtered battery voltage in millivolts
+ *-------------------------------------------------------------------------*/
+uint32_t batteryRead() {
+  uint32_t sum = 0;
+  uint16_t lo = 1023, hi = 0;
+  for (int i = 0; i < BATTERY_OVERSAMPLE; i++) {
+    uint16_t a0 = analogRead(A0);
+    sum += a0;
+    if (a0 < lo) lo = a0;
+    if (a0 > hi) hi = a0;
+    delayMicroseconds(100);       // back to back reads disturb the WiFi
+  }
+  float steps = (float)(sum - lo - hi) / (BATTERY_OVERSAMPLE - 2);
+  float volts = steps * config.batteryScale + config.batteryOffset;
+  uint32_t mv16 = volts > 0 ? (uint32_t)(volts * 1000 * 16) : 0;
+
+  if (state.filteredMv16 == 0) state.filteredMv16 = mv16;
+  else state.filteredMv16 += ((int32_t)mv16 - (int32_t)state.filteredMv16) >> BATTERY_IIR_SHIFT;
+  return batteryMillivolts();
+}
+
+uint32_t batteryMillivolts() {
+  return (state.filteredMv16 + 8) / 16;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to estimate the remaining capacity from the filtered voltage
+ *-------------------------------------------------------------------------*/
+int batteryPercent() {
+  uint32_t mv = batteryMillivolts();
+  const size_t points = sizeof(capacityCurve) / sizeof(capacityCurve[0]);
+  if (mv >= capacityCurve[0].mv) return 100;
+  for (size_t i = 1; i < points; i++) {
+    const CapacityPoint &hi = capacityCurve[i - 1];
+    const CapacityPoint &lo = capacityCurve[i];
+    if (mv >= lo.mv) {
+      return lo.percent + (int)(mv - lo.mv) * (hi.percent - lo.percent) / (hi.mv - lo.mv);
+    }
+  }
+  return 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to stretch a deep sleep interval for a low battery
+ * - limited to the longest deep sleep the chip supports
+ *-------------------------------------------------------------------------*/
+uint64_t batterySleepTime(uint64_t sleepUs) {
+  int percent = batteryPercent();
+  uint8_t scale = 1;
+  for (const BatterySleepStep &step : sleepSteps) {
+    if (percent <= step.percent) {
+      scale = step.scale;
+      break;
+    }
+  }
+  uint64_t stretched = sleepUs * scale;
+  uint64_t limit = ESP.deepSleepMax() * 95 / 100;   // the limit drifts with temperature
+  if (stretched > limit) stretched = limit;
+  if (scale > 1) {
+    Serial.printf("Battery %i%% - sleep x%u\r\n", percent, scale);
+  }
+  return stretched;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to save the filter state before deep sleep
+ *-------------------------------------------------------------------------*/
+void batterySleep() {
+  ESP.rtcUserMemoryWrite(RTC_BATTERY, (uint32_t *)&state, sizeof(state));
+}
@@ -0,0 +1,41 @@
+#ifndef __BATTERY_H__
+#define __BATTERY_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Battery measurement on A0
+// battery voltage divider = 100K/540K = 0.1852
+// max 1V range = 1/.1852 = 5.3995
+// 1024 steps - 0.0053 volts/step
+// actual measured is closer to 0.0051 or 5.15/1024
+// Each reading oversamples A0 and drops the extremes, then an IIR filter
+// smooths the readings; the filter state is kept in RTC memory so it
+// carries across deep sleep.  The per-unit calibration (scale and
+// offset) comes from the configuration.  Remaining capacity is
+// interpolated from a single cell Li-ion discharge curve.
+#define BATTERY_OVERSAMPLE 16     // A0 reads per measurement
+#define BATTERY_IIR_SHIFT 2       // filter weight 1/4 for a new reading
+#define RTC_BATTERY_MAGIC 0x42415431UL  // "BAT1"
+
+// The deep sleep interval is stretched as the battery runs down
+struct BatterySleepStep {
+  uint8_t percent;                // at or below this capacity
+  uint8_t scale;                  // multiply the sleep interval by
+};
+
+struct BatteryState {             // kept in RTC memory
+  uint32_t magic;
+  uint32_t filteredMv16;          // filtered millivolts * 16
+};
+
+//++++++++++++++++++++++
+// Forward function declarations
+void batteryInit(bool reset);
+uint32_t batteryRead();
+uint32_t batteryMillivolts();
+int batteryPercent();
+uint64_t batterySleepTime(uint64_t sleepUs);
+void batterySleep();
+
+#endif  // __BATTERY_H__
@@ -0,0 +1,175 @@
+#include "broker.h"
+#include "rtcmem.h"
+#include "history.h"
+#include "WiFi_Init.h"
+#include <ESP8266mDNS.h>
+#include <coredecls.h>          // crc32()
+#include <lwip/dns.h>           // dns_gethostbyname()
+
+extern Config config;  // declare the external configuration struct
+extern Status status;  // declare the external status struct
+
+static_assert(RTC_BROKER + RTC_BLOCKS(BrokerCache) <= RTC_BROKER_END,
+              "BrokerCache does not fit its RTC memory slot");
+
+BrokerStats brokerStats;
+
+static uint32_t configHash() {
+  uint32_t hash = crc32(config.mqttServer, strlen(config.mqttServer));
+  hash = crc32(config.mqttSecureEnable, strlen(config.mqttSecureEnable), hash);
+  return crc32(&config.mqttPort, sizeof(config.mqttPort), hash);
+}
+
+// the background lookup, written from the network stack's context
+static volatile bool refreshing = false;
+static volatile bool refreshDone = false;
+static IPAddress refreshIp;
+
+// the clock decides when there is one, else the budget of this wake
+static bool cacheFresh(const BrokerCache &cache, uint32_t now) {
+  if (cache.stale) return false;
+  if (now && cache.expires) return now < cache.expires;
+  return millis() / 1000 < cache.leftSec;
+}
+
+// the lookups give no TTL, config.brokerTtl bounds how long it is kept
+static void cacheStore(BrokerCache &cache, uint32_t hash, const IPAddress &ip,
+                       uint16_t port, uint32_t now) {
+  cache.magic = RTC_BROKER_MAGIC;
+  cache.configHash = hash;
+  cache.ip = (uint32_t)ip;
+  cache.port = port;
+  cache.expires = now ? now + config.brokerTtl : 0;
+  cache.leftSec = millis() / 1000 + config.brokerTtl;
+  cache.stale = 0;
+  cache.reserved = 0;
+  ESP.rtcUserMemoryWrite(RTC_BROKER, (uint32_t *)&cache, sizeof(cache));
+}
+
+static void dnsFound(const char *name, const ip_addr_t *addr, void *arg) {
+  if (addr) {
+    refreshIp = IPAddress(addr);
+    refreshDone = true;
+  }
+  refreshing = false;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to look config.mqttServer up again without waiting
+ * - the address is picked up by the next brokerResolve()
+ *-------------------------------------------------------------------------*/
+static void refreshStart() {
+  if (refreshing || refreshDone) return;
+  brokerStats.lookups++;
+  ip_addr_t addr;
+  err_t err = dns_gethostbyname(config.mqttServer, &addr, dnsFound, nullptr);
+  if (err == ERR_OK) {                  // answered from the DNS cache
+    refreshIp = IPAddress(&addr);
+    refreshDone = true;
+  }
+  else if (err == ERR_INPROGRESS) {
+    refreshing = true;
+  }
+  else {
+    Serial.printf("ERROR: DNS lookup of %s not started\r\n", config.mqttServer);
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to find the broker by DNS-SD over mDNS
+ *-------------------------------------------------------------------------*/
+static bool brokerQueryMdns(IPAddress &ip, uint16_t &port) {
+  if (!MDNS.isRunning() && !MDNS.begin(status.host)) {
+    Serial.println("ERROR: mDNS responder did not start");
+    return false;
+  }
+  bool secure = strcmp(config.mqttSecureEnable, "t") == 0;
+  const char *service = secure ? "secure-mqtt" : "mqtt";
+  if (MDNS.queryService(service, "tcp", BROKER_MDNS_TIMEOUT_MS) == 0) {
+    Serial.printf("ERROR: no _%s._tcp service found\r\n", service);
+    return false;
+  }
+  ip = MDNS.IP(0);
+  port = MDNS.port(0);
+  Serial.printf("...broker %s found by mDNS...\r\n", MDNS.hostname(0).c_str());
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return the broker address for the next connect
+ * - uses the cached address until it expires or a connect fails
+ * - lookup allows a blocking DNS or mDNS query, without it a stale or
+ *   expired address is used again and a DNS lookup runs in the
+ *   background for the next call
+ * - returns false when the broker could not be found
+ *-------------------------------------------------------------------------*/
+bool brokerResolve(IPAddress &ip, uint16_t &port, bool lookup) {
+  port = config.mqttPort;
+  if (config.mqttServer[0] && ip.fromString(config.mqttServer)) return true;
+
+  BrokerCache cache;
+  ESP.rtcUserMemoryRead(RTC_BROKER, (uint32_t *)&cache, sizeof(cache));
+  uint32_t hash = configHash();
+  uint32_t now = historyNow();
+  bool dns = config.mqttServer[0] != '\0';
+  if (dns && refreshDone) {             // the background lookup answered
+    refreshDone = false;
+    Serial.printf("...broker %s by DNS...\r\n", refreshIp.toString().c_str());
+    cacheStore(cache, hash, refreshIp, port, now);
+  }
+  bool known = cache.magic == RTC_BROKER_MAGIC && cache.configHash == hash;
+  if (known && cacheFresh(cache, now)) {
+    ip = IPAddress(cache.ip);
+    port = cache.port;
+    brokerStats.cacheHits++;
+    return true;
+  }
+
+  if (!lookup) {                        // from loop() - never wait
+    if (dns) refreshStart();
+    if (!known) return false;
+    ip = IPAddress(cache.ip);
+    port = cache.port;
+    return true;
+  }
+
+  brokerStats.lookups++;
+  uint32_t start = millis();
+  if (dns && !WiFi.hostByName(config.mqttServer, ip)) {
+    Serial.printf("ERROR: DNS lookup of %s failed\r\n", config.mqttServer);
+    return false;
+  }
+  if (!dns && !brokerQueryMdns(ip, port)) return false;
+  Serial.printf("...broker %s:%u by %s in %lu ms...\r\n", ip.toString().c_str(), port,
+                dns ? "DNS" : "mDNS", millis() - start);
+  cacheStore(cache, hash, ip, port, now);
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function called when a connect fails before the broker answered
+ * - the next connect looks the address up again, or from loop() tries
+ *   the same address while a lookup runs in the background
+ *-------------------------------------------------------------------------*/
+void brokerFailed() {
+  if (config.mqttServer[0] && IPAddress().fromString(config.mqttServer)) return;
+  brokerStats.failures++;
+  BrokerCache cache;
+  ESP.rtcUserMemoryRead(RTC_BROKER, (uint32_t *)&cache, sizeof(cache));
+  if (cache.magic != RTC_BROKER_MAGIC) return;
+  cache.stale = 1;
+  ESP.rtcUserMemoryWrite(RTC_BROKER, (uint32_t *)&cache, sizeof(cache));
+}
+
+/*-------------------------------------------------------------------------
+ * Function to charge the cache's TTL budget before deep sleep
+ * - seconds is the time about to be slept
+ *-------------------------------------------------------------------------*/
+void brokerSleep(uint32_t seconds) {
+  BrokerCache cache;
+  ESP.rtcUserMemoryRead(RTC_BROKER, (uint32_t *)&cache, sizeof(cache));
+  if (cache.magic != RTC_BROKER_MAGIC) return;
+  uint32_t spent = millis() / 1000 + seconds;
+  cache.leftSec = cache.leftSec > spent ? cache.leftSec - spent : 0;
+  ESP.rtcUserMemoryWrite(RTC_BROKER, (uint32_t *)&cache, sizeof(cache));
+}
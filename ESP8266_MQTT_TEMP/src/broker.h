@@ -0,0 +1,50 @@
+#ifndef __BROKER_H__
+#define __BROKER_H__
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+//++++++++++++++++++++++
+// Broker address resolution
+// config.mqttServer may be an IP address, a host name resolved by DNS, or
+// empty to find the broker by DNS-SD: the first _mqtt._tcp service
+// (_secure-mqtt._tcp for TLS) answered over mDNS.  The address found is
+// cached in RTC memory for config.brokerTtl seconds, so wakes connect
+// without a lookup.  The TTL runs on the clock when there is one and
+// otherwise on a budget of seconds charged with the time awake and the
+// time asleep, so it ends either way.  A connect that fails before the
+// broker answers marks the cache stale.  Only the first connect of a
+// boot or wake may block on a lookup; the reconnects from loop() use the
+// cache, and when it is stale or expired they keep using the last address
+// while a host name is looked up again in the background for the next
+// attempt.  A broker found by mDNS is only looked up again at the next
+// wake or restart.
+#define BROKER_MDNS_TIMEOUT_MS 1000
+#define RTC_BROKER_MAGIC 0x42524B32UL   // "BRK2"
+
+struct BrokerCache {                  // kept in RTC memory
+  uint32_t magic;
+  uint32_t configHash;                // server, port and TLS setting
+  uint32_t ip;
+  uint32_t expires;                   // epoch, 0 = no clock when cached
+  uint32_t leftSec;                   // TTL left, from this wake's start
+  uint16_t port;
+  uint8_t stale;                      // a connect to it failed
+  uint8_t reserved;
+};
+
+struct BrokerStats {
+  uint32_t lookups;                   // DNS or mDNS queries
+  uint32_t cacheHits;
+  uint32_t failures;                  // connects that made the cache stale
+};
+
+extern BrokerStats brokerStats;
+
+//++++++++++++++++++++++
+// Forward function declarations
+bool brokerResolve(IPAddress &ip, uint16_t &port, bool lookup);
+void brokerFailed();
+void brokerSleep(uint32_t seconds);
+
+#endif  // __BROKER_H__
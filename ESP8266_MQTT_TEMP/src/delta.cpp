@@ -0,0 +1,141 @@
+#include "delta.h"
+
+enum DeltaState {
+  DELTA_HEADER,       // collecting the header
+  DELTA_OP,           // next op byte
+  DELTA_COPY_OFFSET,  // COPY offset varint
+  DELTA_COPY_LENGTH,  // COPY length varint
+  DELTA_ADD_LENGTH,   // ADD length varint
+  DELTA_ADD_DATA,     // ADD literal bytes
+  DELTA_END,          // END seen - nothing more may follow
+  DELTA_ERROR
+};
+
+static bool fail(DeltaDecoder &d, const char *error) {
+  d.error = error;
+  d.state = DELTA_ERROR;
+  return false;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to prepare a decoder for a new upload
+ *-------------------------------------------------------------------------*/
+void deltaInit(DeltaDecoder &d,
+               bool (*begin)(const DeltaHeader &header),
+               bool (*readBase)(uint32_t offset, uint8_t *buf, size_t len),
+               bool (*write)(const uint8_t *buf, size_t len)) {
+  memset(&d, 0, sizeof(d));
+  d.state = DELTA_HEADER;
+  d.begin = begin;
+  d.readBase = readBase;
+  d.write = write;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to copy base bytes to the output a chunk at a time
+ *-------------------------------------------------------------------------*/
+static bool copyBase(DeltaDecoder &d, uint32_t offset, uint32_t len) {
+  if (offset > d.header.baseSize || len > d.header.baseSize - offset) {
+    return fail(d, "COPY outside the base image");
+  }
+  if (len > d.header.targetSize - d.written) return fail(d, "delta too long");
+
+  uint8_t buf[DELTA_COPY_CHUNK];
+  while (len) {
+    size_t n = len < sizeof(buf) ? len : sizeof(buf);
+    if (!d.readBase(offset, buf, n)) return fail(d, "base read failed");
+    if (!d.write(buf, n)) return fail(d, "write failed");
+    offset += n;
+    len -= n;
+    d.written += n;
+  }
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to read one varint byte - returns true once it is complete
+ *-------------------------------------------------------------------------*/
+static bool varintByte(DeltaDecoder &d, uint8_t b) {
+  d.value |= (uint32_t)(b & 0x7F) << d.shift;
+  d.shift += 7;
+  if (b & 0x80) {
+    if (d.shift > 28) fail(d, "bad varint");
+    return false;
+  }
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to decode the next piece of the upload
+ * - returns false once the delta is found bad, d.error says why
+ *-------------------------------------------------------------------------*/
+bool deltaFeed(DeltaDecoder &d, const uint8_t *data, size_t len) {
+  while (len && d.state != DELTA_ERROR) {
+    switch (d.state) {
+      case DELTA_HEADER: {
+        size_t n = sizeof(d.header) - d.headerFill;
+        if (n > len) n = len;
+        memcpy((uint8_t *)&d.header + d.headerFill, data, n);
+        d.headerFill += n;
+        data += n;
+        len -= n;
+        if (d.headerFill < sizeof(d.header)) break;
+        if (memcmp(d.header.magic, DELTA_MAGIC, 4) != 0) return fail(d, "not a delta image");
+        if (!d.begin(d.header)) return fail(d, "rejected by begin");
+        d.state = DELTA_OP;
+        break;
+      }
+      case DELTA_OP:
+        d.op = *data++;
+        len--;
+        d.value = 0;
+        d.shift = 0;
+        if (d.op == DELTA_OP_COPY) d.state = DELTA_COPY_OFFSET;
+        else if (d.op == DELTA_OP_ADD) d.state = DELTA_ADD_LENGTH;
+        else if (d.op == DELTA_OP_END) d.state = DELTA_END;
+        else return fail(d, "unknown op");
+        break;
+      case DELTA_COPY_OFFSET:
+        len--;
+        if (!varintByte(d, *data++)) break;
+        d.offset = d.value;
+        d.value = 0;
+        d.shift = 0;
+        d.state = DELTA_COPY_LENGTH;
+        break;
+      case DELTA_COPY_LENGTH:
+        len--;
+        if (!varintByte(d, *data++)) break;
+        if (!copyBase(d, d.offset, d.value)) return false;
+        d.state = DELTA_OP;
+        break;
+      case DELTA_ADD_LENGTH:
+        len--;
+        if (!varintByte(d, *data++)) break;
+        if (d.value > d.header.targetSize - d.written) return fail(d, "delta too long");
+        d.remaining = d.value;
+        d.state = d.remaining ? DELTA_ADD_DATA : DELTA_OP;
+        break;
+      case DELTA_ADD_DATA: {
+        size_t n = len < d.remaining ? len : d.remaining;
+        if (!d.write(data, n)) return fail(d, "write failed");
+        d.written += n;
+        d.remaining -= n;
+        data += n;
+        len -= n;
+        if (!d.remaining) d.state = DELTA_OP;
+        break;
+      }
+      default:                    // DELTA_END
+        return fail(d, "data after END");
+    }
+  }
+  return d.state != DELTA_ERROR;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to check the delta ended cleanly with the whole image rebuilt
+ *-------------------------------------------------------------------------*/
+bool deltaDone(const DeltaDecoder &d) {
+  return d.state == DELTA_END && d.written == d.header.targetSize;
+}
@@ -0,0 +1,60 @@
+#ifndef __DELTA_H__
+#define __DELTA_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Streaming decoder for delta firmware images
+// A delta rebuilds a new sketch image from the running one, so only the
+// changed bytes cross the network.  Made by tools/ota_image.py:
+//   header  "EDL1" + u32 baseSize + md5 base + u32 targetSize + md5 target
+//   ops     0x01 COPY varint offset, varint length   - bytes of the base
+//           0x02 ADD  varint length, length bytes    - new bytes
+//           0x00 END
+// All integers are little endian, varints are LEB128.  The decoder takes
+// the upload in whatever pieces it arrives and never buffers more than
+// DELTA_COPY_CHUNK bytes.
+#define DELTA_MAGIC "EDL1"
+#define DELTA_COPY_CHUNK 256      // base bytes copied per read
+
+#define DELTA_OP_END  0x00
+#define DELTA_OP_COPY 0x01
+#define DELTA_OP_ADD  0x02
+
+struct __attribute__((packed)) DeltaHeader {
+  char magic[4];
+  uint32_t baseSize;
+  uint8_t baseMd5[16];
+  uint32_t targetSize;
+  uint8_t targetMd5[16];
+};
+
+struct DeltaDecoder {
+  uint8_t state;                  // DeltaState - see delta.cpp
+  uint8_t op;                     // current op
+  uint8_t shift;                  // varint bit position
+  uint32_t value;                 // varint being read
+  uint32_t offset;                // COPY base offset
+  uint32_t remaining;             // ADD bytes still to come
+  size_t headerFill;
+  DeltaHeader header;
+  uint32_t written;               // target bytes produced
+  const char *error;              // why decoding stopped, nullptr if ok
+  // called once the header is complete - false aborts
+  bool (*begin)(const DeltaHeader &header);
+  // reads len bytes of the running image at offset
+  bool (*readBase)(uint32_t offset, uint8_t *buf, size_t len);
+  // receives the rebuilt image in order
+  bool (*write)(const uint8_t *buf, size_t len);
+};
+
+//++++++++++++++++++++++
+// Forward function declarations
+void deltaInit(DeltaDecoder &d,
+               bool (*begin)(const DeltaHeader &header),
+               bool (*readBase)(uint32_t offset, uint8_t *buf, size_t len),
+               bool (*write)(const uint8_t *buf, size_t len));
+bool deltaFeed(DeltaDecoder &d, const uint8_t *data, size_t len);
+bool deltaDone(const DeltaDecoder &d);
+
+#endif  // __DELTA_H__
@@ -0,0 +1,121 @@
+#include "discovery.h"
+#include "rtcmem.h"
+#include "topics.h"
+#include <coredecls.h>          // crc32()
+
+extern Status status;           // declare the external status struct
+extern const char version[];
+
+static_assert(RTC_DISCOVERY + RTC_BLOCKS(DiscoveryRtc) <= RTC_DISCOVERY_END,
+              "DiscoveryRtc does not fit its RTC memory slot");
+
+// one entity announced to Home Assistant
+struct DiscoveryEntity {
+  const char *component;        // sensor or switch
+  const char *id;               // object id, %i for the sensor index
+  const char *name;
+  const char *key;              // JSON key in the outTopic message
+  const char *extra;            // class and unit fields, %s for the cmd topic
+};
+
+static const DiscoveryEntity tempEntity =
+  { "sensor", "t%i", "Temperature %i", "Deg%iC",
+    "\"dev_cla\":\"temperature\",\"unit_of_meas\":\"\xC2\xB0" "C\",\"stat_cla\":\"measurement\"" };
+
+static const DiscoveryEntity hostEntities[] = {
+  { "sensor", "vcc", "Battery voltage", "vcc",
+    "\"dev_cla\":\"voltage\",\"unit_of_meas\":\"V\",\"stat_cla\":\"measurement\"" },
+  { "sensor", "rssi", "WiFi signal", "rssi",
+    "\"dev_cla\":\"signal_strength\",\"unit_of_meas\":\"dBm\",\"ent_cat\":\"diagnostic\"" },
+  { "switch", "relay", "Relay", "relay",
+    "\"cmd_t\":\"%s\",\"pl_on\":\"ON\",\"pl_off\":\"OFF\"" },
+};
+
+/*-------------------------------------------------------------------------
+ * Function to hash everything that goes into the discovery configs
+ *-------------------------------------------------------------------------*/
+static uint32_t discoveryHash(const uint8_t addr[][8], int n) {
+  uint32_t hash = crc32(version, strlen(version));
+  hash = crc32(status.host, strlen(status.host), hash);
+  hash = crc32(mqttTopic(TOPIC_STATUS), strlen(mqttTopic(TOPIC_STATUS)), hash);
+  for (int i = 0; i < n; i++) hash = crc32(addr[i], 8, hash);
+  return crc32(&n, sizeof(n), hash);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to publish the config for one entity
+ * - the templates keep the last state when a message lacks the key,
+ *   the readings of each sensor and the status arrive separately
+ * - an empty payload removes the entity
+ *-------------------------------------------------------------------------*/
+static bool discoveryEntity(const DiscoveryEntity &e, int index, bool remove,
+                            DiscoveryPublishFn publish) {
+  char id[12], name[24], key[12], extra[120], topic[80];
+  static char msg[DISCOVERY_MSG];           // off the stack
+  snprintf(id, sizeof(id), e.id, index);
+  snprintf(name, sizeof(name), e.name, index);
+  snprintf(key, sizeof(key), e.key, index);
+  snprintf(extra, sizeof(extra), e.extra, mqttTopic(TOPIC_CMD));
+  snprintf(topic, sizeof(topic), DISCOVERY_PREFIX "/%s/%s/%s/config",
+           e.component, status.host, id);
+
+  if (remove) return publish(topic, "");
+
+  int len = snprintf(msg, sizeof(msg),
+    "{\"name\":\"%s\",\"uniq_id\":\"%s_%s\",\"stat_t\":\"%s\","
+    "\"val_tpl\":\"{{value_json['%s'].%s|default(this.state)}}\",%s,"
+    "\"dev\":{\"ids\":[\"%s\"],\"name\":\"%s\",\"mdl\":\"ESP8266 MQTT TEMP\",\"sw\":\"%s\"}}",
+    name, status.host, id, mqttTopic(TOPIC_STATUS), status.host, key, extra,
+    status.host, status.host, version);
+  if (len >= (int)sizeof(msg)) {
+    Serial.printf("ERROR: discovery config for '%s' too long\r\n", id);
+    return false;
+  }
+  return publish(topic, msg);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to announce the sensors to Home Assistant when they changed
+ * - addr are the DS18B20 addresses, n the number on the bus
+ * - publish sends a retained message, QoS 0 as the configs are larger
+ *   than the QoS 1 window keeps
+ * - returns true when nothing needed sending or all was sent
+ *-------------------------------------------------------------------------*/
+bool discoveryPublish(const uint8_t addr[][8], int n, DiscoveryPublishFn publish) {
+  DiscoveryRtc rtc;
+  ESP.rtcUserMemoryRead(RTC_DISCOVERY, (uint32_t *)&rtc, sizeof(rtc));
+  if (rtc.magic != RTC_DISCOVERY_MAGIC) {
+    rtc.hash = 0;
+    rtc.sensors = 0;
+  }
+  uint32_t hash = discoveryHash(addr, n);
+  if (rtc.magic == RTC_DISCOVERY_MAGIC && rtc.hash == hash) return true;
+
+  Serial.printf("...publishing Home Assistant discovery for %i sensors...\r\n", n);
+  bool ok = true;
+  for (int i = 0; i < n; i++) ok &= discoveryEntity(tempEntity, i, false, publish);
+  for (int i = n; i < (int)rtc.sensors && i < 32; i++) {
+    ok &= discoveryEntity(tempEntity, i, true, publish);   // removed sensors
+  }
+  for (const DiscoveryEntity &e : hostEntities) ok &= discoveryEntity(e, 0, false, publish);
+  if (!ok) return false;          // try again on the next connect
+
+  rtc.magic = RTC_DISCOVERY_MAGIC;
+  rtc.hash = hash;
+  rtc.sensors = n;
+  ESP.rtcUserMemoryWrite(RTC_DISCOVERY, (uint32_t *)&rtc, sizeof(rtc));
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to force the configs out on the next connect
+ * - the sensor count is kept so removed sensors are still cleared
+ *-------------------------------------------------------------------------*/
+void discoveryReset() {
+  DiscoveryRtc rtc;
+  ESP.rtcUserMemoryRead(RTC_DISCOVERY, (uint32_t *)&rtc, sizeof(rtc));
+  if (rtc.magic != RTC_DISCOVERY_MAGIC) rtc.sensors = 0;
+  rtc.magic = RTC_DISCOVERY_MAGIC;
+  rtc.hash = 0;
+  ESP.rtcUserMemoryWrite(RTC_DISCOVERY, (uint32_t *)&rtc, sizeof(rtc));
+}
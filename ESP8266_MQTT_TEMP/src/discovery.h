@@ -0,0 +1,32 @@
+#ifndef __DISCOVERY_H__
+#define __DISCOVERY_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Home Assistant MQTT discovery
+// A retained config message is published under DISCOVERY_PREFIX for each
+// DS18B20, the supply voltage and the RSSI, and a switch for the relay
+// on inTopic, pointing Home
+// Assistant at the JSON already sent on outTopic.  A CRC of the firmware
+// version, host and sensor addresses is kept in RTC memory with the
+// number of sensors announced, so the configs are only sent again when
+// the inventory or firmware changes - not on every wake.  Sensors that
+// have gone away get an empty retained config, which removes them.
+#define DISCOVERY_PREFIX "homeassistant"
+#define DISCOVERY_MSG 400                 // longest config payload
+#define RTC_DISCOVERY_MAGIC 0x48414431UL  // "HAD1"
+
+struct DiscoveryRtc {                     // kept in RTC memory
+  uint32_t magic;
+  uint32_t hash;                          // of the last configs published
+  uint32_t sensors;                       // temperature configs published
+};
+
+//++++++++++++++++++++++
+// Forward function declarations
+typedef bool (*DiscoveryPublishFn)(const char *topic, const char *msg);
+bool discoveryPublish(const uint8_t addr[][8], int n, DiscoveryPublishFn publish);
+void discoveryReset();
+
+#endif  // __DISCOVERY_H__
@@ -0,0 +1,24 @@
+#include "fixedpoint.h"
+
+/*-------------------------------------------------------------------------
+ * Function to format a fixed-point value with the given decimal places
+ *-------------------------------------------------------------------------*/
+int formatFixed(char *buf, size_t len, int32_t value, uint8_t decimals) {
+  if (decimals == 0) return snprintf(buf, len, "%d", value);
+  int32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; i++) scale *= 10;
+  uint32_t mag = value < 0 ? -(uint32_t)value : value;
+  return snprintf(buf, len, "%s%u.%0*u", value < 0 ? "-" : "",
+                  mag / scale, decimals, mag % scale);
+}
+
+/*-------------------------------------------------------------------------
+ * Functions to format a 1/16 degC reading in degC or degF, 2 decimals
+ *-------------------------------------------------------------------------*/
+int formatTempC(char *buf, size_t len, int16_t raw) {
+  return formatFixed(buf, len, tempCentiC(raw), 2);
+}
+
+int formatTempF(char *buf, size_t len, int16_t raw) {
+  return formatFixed(buf, len, tempCentiF(raw), 2);
+}
@@ -0,0 +1,33 @@
+#ifndef __FIXEDPOINT_H__
+#define __FIXEDPOINT_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Fixed-point values
+// Temperatures are kept as the DS18B20 reports them, a signed count of
+// 1/16 degC, from the bus through the history, the adaptive interval
+// and status.tempRaw.  They become 1/100 degC or degF only where a
+// reading is written out, with integer arithmetic - the ESP8266 has no
+// FPU and every float operation is a library call.  A failed read is
+// kept as TEMP_RAW_INVALID and written out as null or left out.
+#define TEMP_RAW_INVALID INT16_MIN      // no reading from the device
+
+//++++++++++++++++++++++
+// Forward function declarations
+int formatFixed(char *buf, size_t len, int32_t value, uint8_t decimals);
+int formatTempC(char *buf, size_t len, int16_t raw);
+int formatTempF(char *buf, size_t len, int16_t raw);
+
+// 1/16 degC to 1/100 degC, rounded half away from zero
+static inline int32_t tempCentiC(int16_t raw) {
+  return ((int32_t)raw * 25 + (raw < 0 ? -2 : 2)) / 4;
+}
+
+// 1/16 degC to 1/100 degF: raw * 100 * 9 / (16 * 5) + 3200, rounded
+static inline int32_t tempCentiF(int16_t raw) {
+  int32_t v = (int32_t)raw * 45 + 12800;  // 1/400 degF
+  return (v + (v < 0 ? -2 : 2)) / 4;
+}
+
+#endif  // __FIXEDPOINT_H__
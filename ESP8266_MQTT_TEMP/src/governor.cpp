@@ -0,0 +1,113 @@
+#include <user_interface.h>   // system_update_cpu_freq()
+#include "governor.h"
+#include "rtcmem.h"
+
+static_assert(RTC_GOVERNOR + RTC_BLOCKS(GovernorTime) <= RTC_GOVERNOR_END,
+              "GovernorTime does not fit its RTC memory slot");
+
+static uint8_t held = 0;                      // hints holding the boost
+static unsigned long pulseUntil[CPU_HINT_COUNT];
+static uint8_t mhz = GOV_MHZ_LOW;
+static uint32_t lastUs = 0;                   // start of the current period
+static uint64_t usLow = 0, usHigh = 0;        // this wake
+static uint32_t switches = 0;
+static GovernorTime saved;                    // earlier wakes since power on
+
+/*-------------------------------------------------------------------------
+ * Function to add the time since the last call to the current frequency
+ *-------------------------------------------------------------------------*/
+static void account() {
+  uint32_t now = micros();
+  uint32_t dt = now - lastUs;
+  lastUs = now;
+  if (mhz == GOV_MHZ_HIGH) usHigh += dt;
+  else usLow += dt;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to set the frequency the hints currently ask for
+ *-------------------------------------------------------------------------*/
+static void apply() {
+  bool boost = held != 0;
+  for (int i = 0; i < CPU_HINT_COUNT && !boost; i++) {
+    boost = (long)(pulseUntil[i] - millis()) > 0;
+  }
+  uint8_t target = boost ? GOV_MHZ_HIGH : GOV_MHZ_LOW;
+  if (target == mhz) return;
+  account();
+  system_update_cpu_freq(target);
+  mhz = target;
+  switches++;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to start at the low frequency and load the saved totals
+ * - reset clears the totals, used on power on
+ *-------------------------------------------------------------------------*/
+void governorInit(bool reset) {
+  ESP.rtcUserMemoryRead(RTC_GOVERNOR, (uint32_t *)&saved, sizeof(saved));
+  if (reset || saved.magic != RTC_GOVERNOR_MAGIC) {
+    memset(&saved, 0, sizeof(saved));
+    saved.magic = RTC_GOVERNOR_MAGIC;
+    ESP.rtcUserMemoryWrite(RTC_GOVERNOR, (uint32_t *)&saved, sizeof(saved));
+  }
+  mhz = system_get_cpu_freq();
+  lastUs = micros();
+  apply();
+}
+
+void governorBoost(CpuHint hint) {
+  held |= 1 << hint;
+  apply();
+}
+
+void governorRelease(CpuHint hint) {
+  held &= ~(1 << hint);
+  pulseUntil[hint] = millis() + GOV_HOLD_MS;  // no drop between bursts
+  apply();
+}
+
+void governorPulse(CpuHint hint) {
+  pulseUntil[hint] = millis() + GOV_HOLD_MS;
+  apply();
+}
+
+/*-------------------------------------------------------------------------
+ * Function to drop back to the low frequency once the pulses lapse
+ *-------------------------------------------------------------------------*/
+void governorLoop() {
+  apply();
+}
+
+/*-------------------------------------------------------------------------
+ * Functions to report the time at each frequency - this wake, and since
+ * power on including this wake
+ *-------------------------------------------------------------------------*/
+void governorWake(GovernorTime &wake) {
+  account();
+  wake.magic = 0;
+  wake.msLow = usLow / 1000;
+  wake.msHigh = usHigh / 1000;
+  wake.switches = switches;
+}
+
+void governorTotal(GovernorTime &total) {
+  governorWake(total);
+  total.msLow += saved.msLow;
+  total.msHigh += saved.msHigh;
+  total.switches += saved.switches;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to add this wake to the totals in RTC memory before sleep
+ *-------------------------------------------------------------------------*/
+void governorSleep() {
+  GovernorTime wake;
+  governorWake(wake);
+  Serial.printf("CPU: %u ms at %i MHz, %u ms at %i MHz, %u switches\r\n",
+                wake.msLow, GOV_MHZ_LOW, wake.msHigh, GOV_MHZ_HIGH, wake.switches);
+  saved.msLow += wake.msLow;
+  saved.msHigh += wake.msHigh;
+  saved.switches += wake.switches;
+  ESP.rtcUserMemoryWrite(RTC_GOVERNOR, (uint32_t *)&saved, sizeof(saved));
+}
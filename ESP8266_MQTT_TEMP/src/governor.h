@@ -0,0 +1,42 @@
+#ifndef __GOVERNOR_H__
+#define __GOVERNOR_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// CPU frequency governor
+// The core runs at 80 MHz and is raised to 160 MHz only while a
+// subsystem says it has CPU bound work: a TLS handshake, building a
+// payload, receiving an OTA image or serving a web page.  Waits for the
+// network or a sensor conversion gain nothing from the faster clock.
+// Work with a clear end holds the boost with governorBoost()/Release(),
+// work that runs from callbacks gives a governorPulse() and the boost
+// lapses GOV_HOLD_MS after the last one.  Time at each frequency is
+// counted for this wake and, in RTC memory, since power on.
+#define GOV_MHZ_LOW 80
+#define GOV_MHZ_HIGH 160
+#define GOV_HOLD_MS 100UL             // boost kept after a pulse or release
+#define RTC_GOVERNOR_MAGIC 0x474F5631UL // "GOV1"
+
+enum CpuHint { CPU_HINT_TLS, CPU_HINT_SERIALIZE, CPU_HINT_OTA, CPU_HINT_WEB,
+               CPU_HINT_COUNT };
+
+struct GovernorTime {
+  uint32_t magic;                     // RTC copy only
+  uint32_t msLow;                     // ms at GOV_MHZ_LOW
+  uint32_t msHigh;                    // ms at GOV_MHZ_HIGH
+  uint32_t switches;                  // frequency changes
+};
+
+//++++++++++++++++++++++
+// Forward function declarations
+void governorInit(bool reset);
+void governorBoost(CpuHint hint);
+void governorRelease(CpuHint hint);
+void governorPulse(CpuHint hint);
+void governorLoop();
+void governorWake(GovernorTime &wake);
+void governorTotal(GovernorTime &total);
+void governorSleep();
+
+#endif  // __GOVERNOR_H__
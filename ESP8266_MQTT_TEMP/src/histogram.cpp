@@ -0,0 +1,57 @@
+#include "histogram.h"
+
+Histogram histograms[HIST_COUNT];
+
+const char * const histNames[HIST_COUNT] = {
+  "loop", "ota_handle", "mqtt_loop", "mqtt_connect", "mqtt_publish",
+  "temp_convert", "temp_read", "relay",
+};
+
+/*-------------------------------------------------------------------------
+ * Function to count one duration
+ *-------------------------------------------------------------------------*/
+void histRecord(HistId id, uint32_t us) {
+  Histogram &h = histograms[id];
+  int b = us <= 1 ? 0 : 32 - __builtin_clz(us - 1);  // ceil(log2(us))
+  if (b > HIST_BUCKETS - 1) b = HIST_BUCKETS - 1;
+  h.counts[b]++;
+  h.count++;
+  h.sumUs += us;
+  if (us > h.maxUs) h.maxUs = us;
+}
+
+void histRecordSince(HistId id, uint32_t startUs) {
+  histRecord(id, micros() - startUs);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return the upper bound of a bucket in microseconds
+ * - the last bucket has no bound, UINT32_MAX
+ *-------------------------------------------------------------------------*/
+uint32_t histBound(int bucket) {
+  return bucket >= HIST_BUCKETS - 1 ? UINT32_MAX : 1UL << bucket;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to estimate a percentile in microseconds
+ * - the last bucket reports the longest duration seen
+ *-------------------------------------------------------------------------*/
+uint32_t histPercentile(HistId id, uint8_t percent) {
+  const Histogram &h = histograms[id];
+  if (h.count == 0) return 0;
+  uint32_t rank = ((uint64_t)h.count * percent + 99) / 100;  // 1 based
+  if (rank == 0) rank = 1;
+  uint32_t seen = 0;
+  for (int b = 0; b < HIST_BUCKETS; b++) {
+    seen += h.counts[b];
+    if (seen >= rank) return min(histBound(b), h.maxUs);
+  }
+  return h.maxUs;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to clear every histogram
+ *-------------------------------------------------------------------------*/
+void histReset() {
+  memset(histograms, 0, sizeof(histograms));
+}
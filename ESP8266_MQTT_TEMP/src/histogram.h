@@ -0,0 +1,46 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Latency histograms
+// Each histogram counts durations in microseconds into log2 buckets:
+// bucket 0 holds 0-1 us and bucket b holds 2^(b-1) < us <= 2^b, the
+// last bucket everything longer.  Memory is fixed and a record is a
+// count-leading-zeros and three additions.  Percentiles are returned as
+// the upper bound of the bucket that holds them, within a factor of 2.
+// Add a histogram by adding an id to HistId and its name to histNames.
+#define HIST_BUCKETS 24               // last finite bound 2^22 us = 4.2 s
+
+enum HistId {
+  HIST_LOOP,                          // one pass of the main loop
+  HIST_OTA_HANDLE,                    // ArduinoOTA.handle()
+  HIST_MQTT_LOOP,                     // mqttLoop()
+  HIST_MQTT_CONNECT,                  // connectMqtt() to CONNACK
+  HIST_MQTT_PUBLISH,                  // mqttPublish()
+  HIST_TEMP_CONVERT,                  // conversion request to all ready
+  HIST_TEMP_READ,                     // reading every sensor
+  HIST_RELAY,                         // relay command receive to actuation
+  HIST_COUNT                          // must be last
+};
+
+struct Histogram {
+  uint32_t counts[HIST_BUCKETS];
+  uint32_t count;
+  uint64_t sumUs;                     // total of every duration
+  uint32_t maxUs;
+};
+
+extern Histogram histograms[HIST_COUNT];
+extern const char * const histNames[HIST_COUNT];
+
+//++++++++++++++++++++++
+// Forward function declarations
+void histRecord(HistId id, uint32_t us);
+void histRecordSince(HistId id, uint32_t startUs);
+uint32_t histBound(int bucket);
+uint32_t histPercentile(HistId id, uint8_t percent);
+void histReset();
+
+#endif  // __HISTOGRAM_H__
@@ -0,0 +1,400 @@
+#include "history.h"
+#include "WiFi_Init.h"      // needed for config struct
+#include "rtcmem.h"
+#include <time.h>
+
+extern Config config;  // declare the external configuration struct
+
+// writer state - kept in RTC memory so a deep sleep wake can append
+// without scanning the segment, it always describes the data on flash
+#define HISTORY_STATE_MAGIC 0x48535431UL  // "HST1"
+#define HISTORY_RECORD_MAX (5 + 3 * HISTORY_CHANNELS)
+
+struct HistoryState {
+  uint32_t magic;
+  uint32_t segStart;            // current segment, 0 = none
+  uint32_t segBytes;            // bytes in the current segment file
+  uint32_t lastEpoch;           // epoch of the last record
+  uint32_t sleepEpoch;          // clock at deep sleep, 0 = not sleeping
+  uint32_t sleepSeconds;        // requested deep sleep time
+  int16_t lastVals[HISTORY_CHANNELS];
+  uint8_t channels;
+  uint8_t reserved;
+};
+
+static_assert(RTC_HISTORY + RTC_BLOCKS(HistoryState) <= RTC_HISTORY_END,
+              "HistoryState does not fit its RTC memory slot");
+
+static HistoryState state;          // includes the records in pending[]
+static uint8_t pending[HISTORY_BUFFER_SIZE];  // records not yet written
+static size_t pendingLen = 0;
+static unsigned long lastFlush = 0;
+static bool mounted = false;
+static uint32_t wakeEpoch = 0;      // clock estimate carried over deep sleep
+
+// segment index - start epochs in ascending order, loaded on first use
+static uint32_t segments[HISTORY_MAX_SEGMENTS];
+static int segmentCount = -1;
+
+/*-------------------------------------------------------------------------
+ * Varint and zigzag encoding helpers
+ *-------------------------------------------------------------------------*/
+static size_t putVarint(uint8_t *p, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = (v & 0x7F) | 0x80;
+    v >>= 7;
+  }
+  p[n++] = v;
+  return n;
+}
+
+static uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static void segmentPath(char *path, size_t len, uint32_t start) {
+  snprintf(path, len, HISTORY_DIR "/%08x", start);
+}
+
+static void saveState() {
+  ESP.rtcUserMemoryWrite(RTC_HISTORY, (uint32_t *)&state, sizeof(state));
+}
+
+/*-------------------------------------------------------------------------
+ * Function to build the segment index from the directory listing
+ *-------------------------------------------------------------------------*/
+static void loadIndex() {
+  if (segmentCount >= 0) return;
+  segmentCount = 0;
+  Dir dir = LittleFS.openDir(HISTORY_DIR);
+  while (dir.next() && segmentCount < (int)HISTORY_MAX_SEGMENTS) {
+    uint32_t start = strtoul(dir.fileName().c_str(), NULL, 16);
+    if (start == 0) continue;
+    // insertion sort - the directory order is not guaranteed
+    int i = segmentCount++;
+    while (i > 0 && segments[i - 1] > start) {
+      segments[i] = segments[i - 1];
+      i--;
+    }
+    segments[i] = start;
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Record decoding - shared by the reader and the recovery scan
+ *-------------------------------------------------------------------------*/
+static bool readByte(HistoryCursor &cursor, uint8_t &b) {
+  if (cursor.pos == cursor.len) {
+    size_t n = 0;
+    if (cursor.fileLeft) {
+      n = cursor.file.read(cursor.buf, min((uint32_t)sizeof(cursor.buf), cursor.fileLeft));
+      cursor.fileLeft = n ? cursor.fileLeft - n : 0;
+    }
+    else if (cursor.tailPos < cursor.tailLen) {
+      n = min((size_t)sizeof(cursor.buf), (size_t)(cursor.tailLen - cursor.tailPos));
+      memcpy(cursor.buf, cursor.tail + cursor.tailPos, n);
+      cursor.tailPos += n;
+    }
+    cursor.len = n;
+    cursor.pos = 0;
+    if (cursor.len == 0) return false;
+  }
+  b = cursor.buf[cursor.pos++];
+  return true;
+}
+
+static bool readVarint(HistoryCursor &cursor, uint32_t &v) {
+  v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    uint8_t b;
+    if (!readByte(cursor, b)) return false;
+    v |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;                 // corrupt - varint too long
+}
+
+static bool readRecord(HistoryCursor &cursor) {
+  uint32_t v;
+  if (!readVarint(cursor, v)) return false;
+  uint32_t epoch = cursor.epoch + v;
+  int16_t values[HISTORY_CHANNELS];
+  for (int c = 0; c < cursor.channels; c++) {
+    if (!readVarint(cursor, v)) return false;
+    values[c] = cursor.values[c] + unzigzag(v);
+  }
+  cursor.epoch = epoch;
+  memcpy(cursor.values, values, sizeof(values));
+  return true;
+}
+
+static bool openSegment(HistoryCursor &cursor, uint32_t start) {
+  char path[24];
+  segmentPath(path, sizeof(path), start);
+  cursor.file = LittleFS.open(path, "r");
+  cursor.len = cursor.pos = 0;
+  HistoryHeader header;
+  if (!cursor.file ||
+      cursor.file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+      header.magic[0] != HISTORY_MAGIC0 || header.magic[1] != HISTORY_MAGIC1 ||
+      header.channels > HISTORY_CHANNELS) {
+    cursor.file.close();
+    return false;
+  }
+  cursor.channels = header.channels;
+  cursor.epoch = header.startEpoch;
+  memset(cursor.values, 0, sizeof(cursor.values));
+  // the newest segment may have grown since historyOpen() - stop where
+  // it was then and carry on with the records that were in RAM
+  uint32_t size = cursor.file.size();
+  if (start == cursor.snapStart) {
+    size = min(size, cursor.snapBytes);
+    cursor.tailPos = 0;
+  }
+  else cursor.tailPos = cursor.tailLen;
+  cursor.fileLeft = size - sizeof(header);
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to rebuild the writer state from the newest segment
+ * - used after a power on or when RTC memory does not match the flash
+ * - a record cut short by a reset is truncated away
+ *-------------------------------------------------------------------------*/
+static void historyRecover() {
+  memset(&state, 0, sizeof(state));
+  state.magic = HISTORY_STATE_MAGIC;
+  loadIndex();
+
+  while (segmentCount > 0) {
+    uint32_t start = segments[segmentCount - 1];
+    HistoryCursor cursor;
+    cursor.snapStart = 0;       // the whole file, nothing from RAM
+    cursor.tailLen = 0;
+    if (openSegment(cursor, start)) {
+      uint32_t valid = sizeof(HistoryHeader);
+      while (readRecord(cursor)) {
+        valid = cursor.file.position() - (cursor.len - cursor.pos);
+      }
+      uint32_t size = cursor.file.size();
+      cursor.file.close();
+      if (size > valid) {
+        char path[24];
+        segmentPath(path, sizeof(path), start);
+        File f = LittleFS.open(path, "r+");
+        if (f) f.truncate(valid);
+        Serial.printf("History: truncated %s to %u bytes\r\n", path, valid);
+      }
+      state.segStart = start;
+      state.segBytes = valid;
+      state.lastEpoch = cursor.epoch;
+      state.channels = cursor.channels;
+      memcpy(state.lastVals, cursor.values, sizeof(state.lastVals));
+      break;
+    }
+    // unreadable segment - drop it and try the one before
+    char path[24];
+    segmentPath(path, sizeof(path), start);
+    LittleFS.remove(path);
+    segmentCount--;
+  }
+  saveState();
+}
+
+/*-------------------------------------------------------------------------
+ * Function to mount the filesystem, start SNTP and load the writer state
+ *-------------------------------------------------------------------------*/
+bool historyInit() {
+  if (!LittleFS.begin()) {
+    Serial.println("ERROR: LittleFS mount failed - history disabled");
+    return false;
+  }
+  mounted = true;
+  configTime(0, 0, config.ntpServer);   // history is kept in UTC
+
+  ESP.rtcUserMemoryRead(RTC_HISTORY, (uint32_t *)&state, sizeof(state));
+  bool valid = state.magic == HISTORY_STATE_MAGIC;
+  if (valid && state.segStart) {
+    char path[24];
+    segmentPath(path, sizeof(path), state.segStart);
+    File f = LittleFS.open(path, "r");
+    valid = f && f.size() == state.segBytes;
+  }
+  if (valid) {
+    // carry the clock over the deep sleep until SNTP answers
+    if (state.sleepEpoch) wakeEpoch = state.sleepEpoch + state.sleepSeconds;
+    state.sleepEpoch = 0;
+    saveState();
+  }
+  else {
+    Serial.println("History: rebuilding state from flash");
+    historyRecover();
+  }
+  lastFlush = millis();
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return the current UTC epoch, 0 if the time is not known
+ *-------------------------------------------------------------------------*/
+uint32_t historyNow() {
+  time_t now = time(nullptr);
+  if ((uint32_t)now > HISTORY_EPOCH_VALID) return now;
+  if (wakeEpoch) return wakeEpoch + millis() / 1000;
+  return 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to write the buffered records to the current segment
+ *-------------------------------------------------------------------------*/
+void historyFlush() {
+  lastFlush = millis();
+  if (!mounted || pendingLen == 0) return;
+
+  char path[24];
+  segmentPath(path, sizeof(path), state.segStart);
+  File f = LittleFS.open(path, "a");
+  if (!f || f.write(pending, pendingLen) != pendingLen) {
+    // the deltas now reference data that is not on flash - start over
+    Serial.println("ERROR: history write failed");
+    if (f) f.close();
+    pendingLen = 0;
+    historyRecover();
+    return;
+  }
+  f.close();
+  state.segBytes += pendingLen;
+  pendingLen = 0;
+  saveState();
+}
+
+/*-------------------------------------------------------------------------
+ * Function to start a new segment, deleting the oldest when over budget
+ *-------------------------------------------------------------------------*/
+static bool startSegment(uint32_t now, uint8_t channels) {
+  historyFlush();
+  loadIndex();
+  // a segment can not start before the newest one - wait for the clock
+  if (segmentCount > 0 && now <= segments[segmentCount - 1]) return false;
+
+  char path[24];
+  while (segmentCount >= (int)HISTORY_MAX_SEGMENTS) {
+    segmentPath(path, sizeof(path), segments[0]);
+    LittleFS.remove(path);
+    memmove(segments, segments + 1, --segmentCount * sizeof(segments[0]));
+  }
+
+  HistoryHeader header = { { HISTORY_MAGIC0, HISTORY_MAGIC1 }, channels, 0, now };
+  segmentPath(path, sizeof(path), now);
+  File f = LittleFS.open(path, "w");
+  if (!f || f.write((uint8_t *)&header, sizeof(header)) != sizeof(header)) {
+    Serial.println("ERROR: unable to create history segment");
+    return false;
+  }
+  f.close();
+  segments[segmentCount++] = now;
+
+  state.segStart = now;
+  state.segBytes = sizeof(header);
+  state.lastEpoch = now;
+  state.channels = channels;
+  memset(state.lastVals, 0, sizeof(state.lastVals));
+  saveState();
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to append one sample of every channel to the history
+ *-------------------------------------------------------------------------*/
+void historyAppend(const int16_t raw[], int channels) {
+  if (!mounted) return;
+  uint32_t now = historyNow();
+  if (now == 0) return;                   // no clock yet - nothing to index by
+  if (channels > HISTORY_CHANNELS) channels = HISTORY_CHANNELS;
+
+  if (state.segStart == 0 || channels != state.channels || now < state.lastEpoch ||
+      state.segBytes + pendingLen + HISTORY_RECORD_MAX > HISTORY_SEGMENT_SIZE) {
+    if (!startSegment(now, channels)) return;
+  }
+
+  uint8_t rec[HISTORY_RECORD_MAX];
+  size_t n = putVarint(rec, now - state.lastEpoch);
+  for (int c = 0; c < channels; c++) {
+    int16_t v = raw[c];
+    n += putVarint(rec + n, zigzag(v - state.lastVals[c]));
+    state.lastVals[c] = v;
+  }
+  state.lastEpoch = now;
+
+  if (pendingLen + n > sizeof(pending)) historyFlush();
+  memcpy(pending + pendingLen, rec, n);
+  pendingLen += n;
+  if (millis() - lastFlush > HISTORY_FLUSH_INTERVAL) historyFlush();
+}
+
+/*-------------------------------------------------------------------------
+ * Function to save the history before a deep sleep of the given length
+ *-------------------------------------------------------------------------*/
+void historySleep(uint32_t seconds) {
+  if (!mounted) return;
+  historyFlush();
+  state.sleepEpoch = historyNow();
+  state.sleepSeconds = seconds;
+  saveState();
+}
+
+/*-------------------------------------------------------------------------
+ * Functions to read back the records between from and to (inclusive)
+ * - called from the web server, so nothing is written here: the records
+ *   still in RAM are copied into the cursor instead of being flushed
+ * - segments are followed by start epoch, so deleting the oldest one
+ *   while a cursor is open does not make it skip another
+ *-------------------------------------------------------------------------*/
+bool historyOpen(HistoryCursor &cursor, uint32_t from, uint32_t to) {
+  cursor.from = from;
+  cursor.to = to;
+  cursor.snapStart = state.segStart;
+  cursor.snapBytes = state.segBytes;
+  memcpy(cursor.tail, pending, pendingLen);
+  cursor.tailLen = pendingLen;
+  if (!mounted) return false;
+  loadIndex();
+  if (segmentCount <= 0) return false;
+
+  // start in the last segment that begins at or before from
+  int i = 0;
+  while (i + 1 < segmentCount && segments[i + 1] <= from) i++;
+  cursor.segStart = segments[i];
+  return openSegment(cursor, cursor.segStart);
+}
+
+bool historyNext(HistoryCursor &cursor) {
+  while (cursor.file) {
+    if (readRecord(cursor)) {
+      if (cursor.epoch > cursor.to) break;
+      if (cursor.epoch >= cursor.from) return true;
+      continue;
+    }
+    // end of this segment - move on to the next one in the window, up
+    // to the newest when the cursor was opened
+    cursor.file.close();
+    if (cursor.segStart == cursor.snapStart) break;
+    for (int i = 0; i < segmentCount && !cursor.file; i++) {
+      if (segments[i] <= cursor.segStart) continue;
+      if (segments[i] > cursor.to) break;
+      cursor.segStart = segments[i];
+      openSegment(cursor, cursor.segStart);
+    }
+  }
+  historyClose(cursor);
+  return false;
+}
+
+void historyClose(HistoryCursor &cursor) {
+  if (cursor.file) cursor.file.close();
+}
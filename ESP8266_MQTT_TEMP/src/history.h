@@ -0,0 +1,70 @@
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+//++++++++++++++++++++++
+// On-flash reading history
+// Samples are appended to segment files in LittleFS named after the
+// epoch of their first record (/hist/<hex epoch>).  A segment starts with
+// a HistoryHeader followed by records of
+//   varint(seconds since previous record) + zigzag varint(value delta)
+// for each channel, values in 1/16 degC, TEMP_RAW_INVALID (INT16_MIN)
+// for a failed read.  A record is usually 2 bytes
+// plus 1 per channel, so weeks of 10 second samples fit in the budget.
+// The oldest segment is deleted when the budget is used up; LittleFS does
+// the wear levelling.  The segment start epochs are the index used to
+// seek to a time window.
+#define HISTORY_DIR "/hist"
+#define HISTORY_SEGMENT_SIZE 16384UL      // roll to a new segment file
+#define HISTORY_MAX_BYTES (1536UL * 1024)  // 1.5 MB of the 2 MB filesystem
+#define HISTORY_MAX_SEGMENTS (HISTORY_MAX_BYTES / HISTORY_SEGMENT_SIZE)
+#define HISTORY_CHANNELS 5                // same as MAX_DEVICES
+#define HISTORY_BUFFER_SIZE 256           // records buffered before a write
+#define HISTORY_FLUSH_INTERVAL 300000UL   // max time records stay in RAM
+#define HISTORY_EPOCH_VALID 1600000000UL  // SNTP time is set if past this
+
+#define HISTORY_MAGIC0 'H'
+#define HISTORY_MAGIC1 '1'
+
+struct HistoryHeader {          // first bytes of every segment file
+  char magic[2];
+  uint8_t channels;
+  uint8_t reserved;
+  uint32_t startEpoch;          // epoch the record deltas start from
+};
+
+struct HistoryCursor {          // read position for historyOpen()/Next()
+  uint32_t from;
+  uint32_t to;
+  uint32_t segStart;            // segment being read, by its start epoch
+  File file;
+  uint32_t fileLeft;            // bytes of file still to be read
+  uint8_t channels;
+  uint32_t epoch;               // last decoded record
+  int16_t values[HISTORY_CHANNELS];
+  uint8_t buf[64];              // read buffer for file
+  uint8_t len;
+  uint8_t pos;
+  // the newest segment as it was when opened: its length on flash and
+  // the records that were still in RAM, read after the file
+  uint32_t snapStart;
+  uint32_t snapBytes;
+  uint8_t tail[HISTORY_BUFFER_SIZE];
+  uint16_t tailLen;
+  uint16_t tailPos;
+};
+
+//++++++++++++++++++++++
+// Forward function declarations
+bool historyInit();
+uint32_t historyNow();
+void historyAppend(const int16_t raw[], int channels);
+void historyFlush();
+void historySleep(uint32_t seconds);
+bool historyOpen(HistoryCursor &cursor, uint32_t from, uint32_t to);
+bool historyNext(HistoryCursor &cursor);
+void historyClose(HistoryCursor &cursor);
+
+#endif  // __HISTORY_H__
@@ -0,0 +1,52 @@
+#include "i2cbus.h"
+
+/*-------------------------------------------------------------------------
+ * Function to check that a device acknowledges its address
+ *-------------------------------------------------------------------------*/
+bool WireBus::probe(uint8_t addr) {
+  transactions++;
+  wire.beginTransmission(addr);
+  return wire.endTransmission() == 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to write a command or register block and release the bus
+ *-------------------------------------------------------------------------*/
+bool WireBus::write(uint8_t addr, const uint8_t *data, size_t len) {
+  transactions++;
+  wire.beginTransmission(addr);
+  wire.write(data, len);
+  if (wire.endTransmission() == 0) return true;
+  errors++;
+  return false;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to read len bytes from a device
+ *-------------------------------------------------------------------------*/
+bool WireBus::read(uint8_t addr, uint8_t *data, size_t len) {
+  transactions++;
+  if (wire.requestFrom(addr, len) != len) {
+    errors++;
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) data[i] = wire.read();
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to write a register address and read back its contents
+ * - repeated start between the two halves, one stop at the end
+ *-------------------------------------------------------------------------*/
+bool WireBus::writeRead(uint8_t addr, const uint8_t *out, size_t outLen,
+                        uint8_t *in, size_t inLen) {
+  transactions++;
+  wire.beginTransmission(addr);
+  wire.write(out, outLen);
+  if (wire.endTransmission(false) != 0 || wire.requestFrom(addr, inLen) != inLen) {
+    errors++;
+    return false;
+  }
+  for (size_t i = 0; i < inLen; i++) in[i] = wire.read();
+  return true;
+}
@@ -0,0 +1,32 @@
+#ifndef __I2CBUS_H__
+#define __I2CBUS_H__
+
+#include <Arduino.h>
+#include <Wire.h>
+
+//++++++++++++++++++++++
+// I2C bus access for the sensor drivers
+// Drivers never touch Wire directly, they take the bus as a template
+// parameter and only use the four calls below.  Each call is one bus
+// transaction: a register read is the register write and the data read
+// joined by a repeated start, so no other master or driver can slip in
+// between and the bus is released once.  A mock with the same members
+// can stand in for WireBus to run the drivers off target.
+class WireBus {
+ public:
+  explicit WireBus(TwoWire &wire) : wire(wire) {}
+
+  bool probe(uint8_t addr);
+  bool write(uint8_t addr, const uint8_t *data, size_t len);
+  bool read(uint8_t addr, uint8_t *data, size_t len);
+  bool writeRead(uint8_t addr, const uint8_t *out, size_t outLen,
+                 uint8_t *in, size_t inLen);
+
+  uint32_t transactions = 0;            // since boot
+  uint32_t errors = 0;                  // NACKs and short reads
+
+ private:
+  TwoWire &wire;
+};
+
+#endif  // __I2CBUS_H__
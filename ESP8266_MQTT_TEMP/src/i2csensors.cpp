@@ -0,0 +1,27 @@
+#include "i2csensors.h"
+#include "fixedpoint.h"
+
+/*-------------------------------------------------------------------------
+ * Function to format a reading value as a decimal string
+ * - returns the snprintf() length, "" for an invalid reading
+ *-------------------------------------------------------------------------*/
+int readingFormat(char *buf, size_t len, const Reading &r) {
+  if (!r.valid) {
+    if (len) buf[0] = '\0';
+    return 0;
+  }
+  return formatFixed(buf, len, r.value, r.decimals);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to compute the Sensirion CRC-8 of a data word
+ * - polynomial 0x31, initial value 0xFF
+ *-------------------------------------------------------------------------*/
+uint8_t sensirionCrc(const uint8_t *data, size_t len) {
+  uint8_t crc = 0xFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+  return crc;
+}
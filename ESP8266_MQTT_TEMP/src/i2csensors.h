@@ -0,0 +1,221 @@
+#ifndef __I2CSENSORS_H__
+#define __I2CSENSORS_H__
+
+#include <Arduino.h>
+#include <tuple>
+#include <utility>
+
+//++++++++++++++++++++++
+// I2C sensor drivers
+// The drivers fitted to a build are listed once, as the template
+// arguments of a SensorSet in main.h, so each call below is resolved at
+// compile time - no vtables and no driver that is not listed is linked.
+// A driver is a struct with:
+//   static constexpr uint8_t CHANNELS     readings it produces
+//   template <class Bus> bool begin(Bus&)        probe and set up
+//   template <class Bus> uint16_t start(Bus&)    trigger a conversion,
+//                                                ms until it is ready,
+//                                                0 on failure
+//   template <class Bus> bool read(Bus&, Reading*) fetch CHANNELS values
+// A sample starts every driver back to back and the caller waits once
+// for the slowest, in the same window as the DS18B20 conversion, then
+// reads everything into one Reading table for publishReadings().
+// Values are fixed point like the Prometheus table, scaled by
+// 10^decimals, and the drivers use integer arithmetic only.
+
+struct Reading {
+  const char *name;                     // "<driver>_<quantity>"
+  const char *unit;
+  int32_t value;                        // scaled by 10^decimals
+  uint8_t decimals;
+  bool valid;                           // false after a failed read
+};
+
+//++++++++++++++++++++++
+// Forward function declarations
+int readingFormat(char *buf, size_t len, const Reading &r);
+uint8_t sensirionCrc(const uint8_t *data, size_t len);
+
+static inline void readingSet(Reading &r, const char *name, const char *unit,
+                              int32_t value, uint8_t decimals, bool valid) {
+  r.name = name;
+  r.unit = unit;
+  r.value = value;
+  r.decimals = decimals;
+  r.valid = valid;
+}
+
+//++++++++++++++++++++++
+// Sensirion SHT3x humidity and temperature, ADDR pin low
+// single shot, high repeatability, no clock stretching
+struct Sht3x {
+  static constexpr uint8_t CHANNELS = 2;
+  static constexpr uint8_t ADDR = 0x44;
+
+  template <class Bus> bool begin(Bus &bus) {
+    return bus.probe(ADDR);
+  }
+  template <class Bus> uint16_t start(Bus &bus) {
+    static const uint8_t cmd[] = {0x24, 0x00};
+    return bus.write(ADDR, cmd, sizeof(cmd)) ? 16 : 0;
+  }
+  template <class Bus> bool read(Bus &bus, Reading *out) {
+    uint8_t d[6] = {};
+    bool ok = bus.read(ADDR, d, sizeof(d)) &&
+              sensirionCrc(d, 2) == d[2] && sensirionCrc(d + 3, 2) == d[5];
+    int32_t t = ((uint32_t)d[0] << 8) | d[1];
+    int32_t rh = ((uint32_t)d[3] << 8) | d[4];
+    readingSet(out[0], "sht3x_temp", "C", -4500 + 17500 * t / 65535, 2, ok);
+    readingSet(out[1], "sht3x_rh", "%", 10000 * rh / 65535, 2, ok);
+    return ok;
+  }
+};
+
+//++++++++++++++++++++++
+// Bosch BMP280 (or the BME280, humidity unused) pressure and
+// temperature, SDO low, forced mode with x1 oversampling
+struct Bmp280 {
+  static constexpr uint8_t CHANNELS = 2;
+  static constexpr uint8_t ADDR = 0x76;
+
+  template <class Bus> bool begin(Bus &bus) {
+    uint8_t reg = 0xD0, id;             // chip id
+    if (!bus.writeRead(ADDR, &reg, 1, &id, 1) || (id != 0x58 && id != 0x60)) return false;
+    uint8_t c[24];
+    reg = 0x88;                         // calibration block, little endian
+    if (!bus.writeRead(ADDR, &reg, 1, c, sizeof(c))) return false;
+    for (int i = 0; i < 12; i++) cal[i] = c[2 * i] | (c[2 * i + 1] << 8);
+    return true;
+  }
+  template <class Bus> uint16_t start(Bus &bus) {
+    static const uint8_t ctrl[] = {0xF4, 0x25};   // x1, x1, forced
+    return bus.write(ADDR, ctrl, sizeof(ctrl)) ? 7 : 0;
+  }
+  template <class Bus> bool read(Bus &bus, Reading *out) {
+    uint8_t reg = 0xF7, d[6] = {};      // pressure and temperature at once
+    bool ok = bus.writeRead(ADDR, &reg, 1, d, sizeof(d));
+    int32_t adcP = ((int32_t)d[0] << 12) | (d[1] << 4) | (d[2] >> 4);
+    int32_t adcT = ((int32_t)d[3] << 12) | (d[4] << 4) | (d[5] >> 4);
+    int32_t tFine;
+    int32_t t = temperature(adcT, tFine);
+    uint32_t pa = pressure(adcP, tFine);
+    ok = ok && pa != 0;
+    readingSet(out[0], "bmp280_temp", "C", t, 2, ok);
+    readingSet(out[1], "bmp280_press", "hPa", pa, 2, ok);
+    return ok;
+  }
+
+ private:
+  uint16_t cal[12];                     // dig_T1..T3, dig_P1..P9
+
+  int32_t temperature(int32_t adc, int32_t &tFine) {   // 1/100 degC
+    int32_t t1 = cal[0], t2 = (int16_t)cal[1], t3 = (int16_t)cal[2];
+    int32_t var1 = ((((adc >> 3) - (t1 << 1))) * t2) >> 11;
+    int32_t var2 = (((((adc >> 4) - t1) * ((adc >> 4) - t1)) >> 12) * t3) >> 14;
+    tFine = var1 + var2;
+    return (tFine * 5 + 128) >> 8;
+  }
+  uint32_t pressure(int32_t adc, int32_t tFine) {      // Pa, 0 on error
+    int64_t var1 = (int64_t)tFine - 128000;
+    int64_t var2 = var1 * var1 * (int16_t)cal[8];
+    var2 += (var1 * (int16_t)cal[7]) * 131072;
+    var2 += (int64_t)(int16_t)cal[6] * 34359738368LL;
+    var1 = ((var1 * var1 * (int16_t)cal[5]) / 256) + ((var1 * (int16_t)cal[4]) * 4096);
+    var1 = ((140737488355328LL + var1) * cal[3]) / 8589934592LL;
+    if (var1 == 0) return 0;
+    int64_t p = 1048576 - adc;
+    p = (((p * 2147483648LL) - var2) * 3125) / var1;
+    var1 = ((int64_t)(int16_t)cal[11] * (p / 8192) * (p / 8192)) / 33554432;
+    var2 = ((int64_t)(int16_t)cal[10] * p) / 524288;
+    p = ((p + var1 + var2) / 256) + ((int64_t)(int16_t)cal[9] * 16);
+    return (uint32_t)(p / 256);
+  }
+};
+
+//++++++++++++++++++++++
+// TI ADS1115 16 bit ADC, ADDR to GND
+// AIN0 single ended, +-4.096 V, single shot at 128 SPS
+struct Ads1115 {
+  static constexpr uint8_t CHANNELS = 1;
+  static constexpr uint8_t ADDR = 0x48;
+
+  template <class Bus> bool begin(Bus &bus) {
+    return bus.probe(ADDR);
+  }
+  template <class Bus> uint16_t start(Bus &bus) {
+    static const uint8_t config[] = {0x01, 0xC3, 0x83};
+    return bus.write(ADDR, config, sizeof(config)) ? 9 : 0;
+  }
+  template <class Bus> bool read(Bus &bus, Reading *out) {
+    uint8_t reg = 0x00, d[2] = {};      // conversion register
+    bool ok = bus.writeRead(ADDR, &reg, 1, d, sizeof(d));
+    int16_t raw = (d[0] << 8) | d[1];
+    readingSet(out[0], "ads1115_ain0", "V", raw / 8, 3, ok);   // 125 uV/step
+    return ok;
+  }
+};
+
+//++++++++++++++++++++++
+// The driver registry
+// Drivers that do not answer in begin() are skipped for good, readings
+// of the ones present are packed into the table in list order.
+template <class Bus, class... Drivers>
+class SensorSet {
+ public:
+  static constexpr size_t CHANNELS = (0 + ... + Drivers::CHANNELS);
+  static constexpr size_t COUNT = sizeof...(Drivers);
+
+  explicit SensorSet(Bus &bus) : bus(bus) {}
+
+  /*---- Function to probe every driver, returns the number found ----*/
+  int begin() {
+    int found = 0;
+    each([&](auto &drv, size_t i) {
+      present[i] = drv.begin(bus);
+      found += present[i];
+    });
+    return found;
+  }
+
+  /*---- Function to start every conversion, returns the longest wait ----*/
+  uint16_t start() {
+    uint16_t wait = 0;
+    each([&](auto &drv, size_t i) {
+      if (!present[i]) return;
+      uint16_t ms = drv.start(bus);
+      started[i] = ms != 0;
+      if (ms > wait) wait = ms;
+    });
+    return wait;
+  }
+
+  /*---- Function to read the started drivers, returns table entries ----*/
+  size_t read(Reading *table) {
+    size_t n = 0;
+    each([&](auto &drv, size_t i) {
+      if (!present[i]) return;
+      if (started[i]) drv.read(bus, table + n);
+      else for (size_t c = 0; c < drv.CHANNELS; c++) table[n + c].valid = false;
+      started[i] = false;
+      n += drv.CHANNELS;
+    });
+    return n;
+  }
+
+ private:
+  Bus &bus;
+  std::tuple<Drivers...> drivers;
+  bool present[COUNT] = {};
+  bool started[COUNT] = {};
+
+  template <class Fn, size_t... I>
+  void each(Fn &&fn, std::index_sequence<I...>) {
+    (fn(std::get<I>(drivers), I), ...);
+  }
+  template <class Fn>
+  void each(Fn &&fn) {
+    each(fn, std::index_sequence_for<Drivers...>());
+  }
+};
+
+#endif  // __I2CSENSORS_H__
@@ -0,0 +1,138 @@
+#include "inflight.h"
+#include "mqtt_codec.h"
+
+InflightStats inflightStats;  // instantiate the in-flight statistics
+
+struct InflightMsg {          // one QoS 1 message awaiting its PUBACK
+  uint16_t packetId;          // 0 = free slot
+  bool retain;
+  unsigned long sentAt;       // millis() of the last (re)send
+  unsigned long firstSent;    // millis() of the first send
+  char topic[MQTT_INFLIGHT_TOPIC];
+  char payload[MQTT_INFLIGHT_MSG];
+};
+
+static InflightMsg window[MQTT_INFLIGHT_MAX];
+static size_t (*writePacket)(const uint8_t *buf, size_t len) = nullptr;
+static uint16_t nextPacketId = 0;
+
+/*-------------------------------------------------------------------------
+ * Function to set the writer QoS 1 packets are sent with
+ *-------------------------------------------------------------------------*/
+void inflightInit(size_t (*write)(const uint8_t *buf, size_t len)) {
+  writePacket = write;
+  memset(window, 0, sizeof(window));
+  memset(&inflightStats, 0, sizeof(inflightStats));
+}
+
+bool inflightFull() {
+  return inflightCount() >= MQTT_INFLIGHT_MAX;
+}
+
+int inflightCount() {
+  int n = 0;
+  for (int i = 0; i < MQTT_INFLIGHT_MAX; i++) {
+    if (window[i].packetId) n++;
+  }
+  return n;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to write one QoS 1 PUBLISH packet in a single write
+ *-------------------------------------------------------------------------*/
+static bool sendPublish(const InflightMsg &m, bool dup) {
+  uint8_t packet[5 + 2 + MQTT_INFLIGHT_TOPIC + 2 + MQTT_INFLIGHT_MSG];
+  size_t n = mqttEncodePublish(packet, sizeof(packet), m.topic,
+                               (const uint8_t *)m.payload, strlen(m.payload),
+                               1, m.retain, dup, m.packetId);
+  return n && writePacket && writePacket(packet, n) == n;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to publish at QoS 1 through the in-flight window
+ * - returns the packet id, 0 if the window is full, the message does not
+ *   fit or the write fails
+ *-------------------------------------------------------------------------*/
+uint16_t inflightPublish(const char *topic, const char *msg, bool retain) {
+  if (strlen(topic) >= MQTT_INFLIGHT_TOPIC || strlen(msg) >= MQTT_INFLIGHT_MSG) {
+    Serial.println("ERROR: message too long for the QoS 1 window");
+    return 0;
+  }
+  InflightMsg *m = nullptr;
+  for (int i = 0; i < MQTT_INFLIGHT_MAX && !m; i++) {
+    if (!window[i].packetId) m = &window[i];
+  }
+  if (!m) return 0;
+
+  // ids MQTT_PACKET_ID_BASE..0xFFFF - never 0 and never a SUBSCRIBE id
+  nextPacketId = (nextPacketId + 1) & 0x7FFF;
+  m->packetId = MQTT_PACKET_ID_BASE | nextPacketId;
+  m->retain = retain;
+  strcpy(m->topic, topic);
+  strcpy(m->payload, msg);
+  m->firstSent = m->sentAt = millis();
+
+  if (!sendPublish(*m, false)) {
+    m->packetId = 0;
+    return 0;
+  }
+  inflightStats.published++;
+  return m->packetId;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to release the window slot acknowledged by a PUBACK
+ *-------------------------------------------------------------------------*/
+void inflightAck(uint16_t packetId) {
+  for (int i = 0; i < MQTT_INFLIGHT_MAX; i++) {
+    if (window[i].packetId == packetId) {
+      uint32_t ackMs = millis() - window[i].firstSent;
+      if (ackMs > inflightStats.ackMaxMs) inflightStats.ackMaxMs = ackMs;
+      window[i].packetId = 0;
+      inflightStats.acked++;
+      return;
+    }
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to resend the messages that have waited MQTT_RETRY_MS
+ *-------------------------------------------------------------------------*/
+void inflightRetry() {
+  for (int i = 0; i < MQTT_INFLIGHT_MAX; i++) {
+    InflightMsg &m = window[i];
+    if (m.packetId && millis() - m.sentAt > MQTT_RETRY_MS) {
+      m.sentAt = millis();
+      if (sendPublish(m, true)) inflightStats.retries++;
+    }
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to resend every unacknowledged message after a reconnect
+ *-------------------------------------------------------------------------*/
+void inflightResend() {
+  for (int i = 0; i < MQTT_INFLIGHT_MAX; i++) {
+    InflightMsg &m = window[i];
+    if (m.packetId) {
+      m.sentAt = millis();
+      if (sendPublish(m, true)) inflightStats.retries++;
+    }
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to hand every unacknowledged message to fn and empty the window
+ * - used before deep sleep so the messages can be spooled, not lost
+ *-------------------------------------------------------------------------*/
+int inflightTakeUnacked(void (*fn)(const char *topic, const char *msg)) {
+  int n = 0;
+  for (int i = 0; i < MQTT_INFLIGHT_MAX; i++) {
+    if (window[i].packetId) {
+      fn(window[i].topic, window[i].payload);
+      window[i].packetId = 0;
+      n++;
+    }
+  }
+  return n;
+}
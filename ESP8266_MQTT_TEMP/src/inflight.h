@@ -0,0 +1,41 @@
+#ifndef __INFLIGHT_H__
+#define __INFLIGHT_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// MQTT QoS 1 publishing with an in-flight window
+// QoS 1 PUBLISH packets are kept in a small window until the broker's
+// PUBACK for their packet id arrives, so several messages are pipelined
+// without waiting one round trip each.  Unacknowledged messages are
+// resent with DUP set after MQTT_RETRY_MS and after every reconnect.
+#define QOS_0 0
+#define QOS_1 1
+#define QOS_2 2
+#define MQTT_INFLIGHT_MAX 4         // QoS 1 messages awaiting a PUBACK
+#define MQTT_INFLIGHT_TOPIC 64      // longest topic kept in the window
+#define MQTT_INFLIGHT_MSG 200       // longest payload kept in the window
+#define MQTT_RETRY_MS 5000UL        // resend an unacknowledged message
+#define MQTT_PACKET_ID_BASE 0x8000  // SUBSCRIBE uses the ids from 1 up
+
+struct InflightStats {
+  uint32_t published;       // QoS 1 messages sent
+  uint32_t acked;           // PUBACKs received
+  uint32_t retries;         // messages resent with DUP
+  uint32_t ackMaxMs;        // longest time to PUBACK
+};
+
+extern InflightStats inflightStats;
+
+//++++++++++++++++++++++
+// Forward function declarations
+void inflightInit(size_t (*write)(const uint8_t *buf, size_t len));
+bool inflightFull();
+int inflightCount();
+uint16_t inflightPublish(const char *topic, const char *msg, bool retain);
+void inflightAck(uint16_t packetId);
+void inflightRetry();
+void inflightResend();
+int inflightTakeUnacked(void (*fn)(const char *topic, const char *msg));
+
+#endif  // __INFLIGHT_H__
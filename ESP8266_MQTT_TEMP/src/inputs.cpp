@@ -0,0 +1,78 @@
+#include "inputs.h"
+
+// written by the interrupt handler
+struct InputEdge {
+  volatile uint32_t edgeMs;       // millis() of the last edge
+  volatile bool level;            // level after the last edge
+  volatile bool pending;          // edge not yet debounced
+};
+
+static InputEdge edges[INPUT_COUNT];
+static uint8_t pins[INPUT_COUNT];
+static bool levels[INPUT_COUNT];  // debounced level
+static void (*changeFn)(InputId id, bool level) = nullptr;
+
+static void IRAM_ATTR inputEdge(int i) {
+  edges[i].level = digitalRead(pins[i]);
+  edges[i].edgeMs = millis();
+  edges[i].pending = true;
+}
+
+// one handler per input, attachInterrupt() passes no argument
+template <int i> static void IRAM_ATTR inputIsr() {
+  inputEdge(i);
+}
+
+static void (* const isrs[INPUT_COUNT])() = {
+  inputIsr<INPUT_SLEEP>,
+};
+
+/*-------------------------------------------------------------------------
+ * Function to configure an input pin and start watching its edges
+ * - the level read here is taken as debounced
+ *-------------------------------------------------------------------------*/
+void inputAttach(InputId id, uint8_t pin, uint8_t mode) {
+  pins[id] = pin;
+  pinMode(pin, mode);
+  levels[id] = digitalRead(pin);
+  edges[id].pending = false;
+  attachInterrupt(digitalPinToInterrupt(pin), isrs[id], CHANGE);
+}
+
+void inputsOnChange(void (*fn)(InputId id, bool level)) {
+  changeFn = fn;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to accept the inputs that have settled
+ * - calls the change handler for each debounced change of level
+ *-------------------------------------------------------------------------*/
+void inputsLoop() {
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    if (!edges[i].pending) continue;
+    noInterrupts();
+    uint32_t edgeMs = edges[i].edgeMs;
+    bool level = edges[i].level;
+    bool settled = millis() - edgeMs >= INPUT_DEBOUNCE_MS;
+    if (settled) edges[i].pending = false;
+    interrupts();
+    if (!settled || level == levels[i]) continue;   // bounce or glitch
+
+    levels[i] = level;
+    if (changeFn) changeFn((InputId)i, level);
+  }
+}
+
+bool inputLevel(InputId id) {
+  return levels[id];
+}
+
+/*-------------------------------------------------------------------------
+ * Function to tell if an edge is still waiting to be debounced
+ *-------------------------------------------------------------------------*/
+bool inputsPending() {
+  for (const InputEdge &e : edges) {
+    if (e.pending) return true;
+  }
+  return false;
+}
@@ -0,0 +1,28 @@
+#ifndef __INPUTS_H__
+#define __INPUTS_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Debounced digital inputs
+// Each input pin has a CHANGE interrupt that only stores the level and
+// the time of the edge.  inputsLoop() accepts a level once it has held
+// for INPUT_DEBOUNCE_MS, updates the cached state and calls the change
+// handler from loop context, so nothing needs to read the pins.  Add an
+// input by adding an id to InputId and attaching it in setup().
+#define INPUT_DEBOUNCE_MS 30UL
+
+enum InputId {
+  INPUT_SLEEP,                    // high = deep sleep, low = stay awake
+  INPUT_COUNT                     // must be last
+};
+
+//++++++++++++++++++++++
+// Forward function declarations
+void inputAttach(InputId id, uint8_t pin, uint8_t mode);
+void inputsOnChange(void (*fn)(InputId id, bool level));
+void inputsLoop();
+bool inputLevel(InputId id);
+bool inputsPending();
+
+#endif  // __INPUTS_H__
@@ -31,13 +31,38 @@
  * 1.00 - Clean compiled version with several changes for the Platform
  *        IO / Visual Studio Code environment
  * 1.01 - minor changes to console status messages
+ * 1.02 - MQTT topic paths built once from a compile-time topic table
+ * 1.03 - heap, stack and loop rate telemetry on the /metrics topic
+ * 1.04 - Prometheus /metrics endpoint on the web server
+ * 1.05 - live readings pushed to browsers as Server-Sent Events
+ * 1.06 - gzipped PROGMEM web assets with ETag caching
+ * 1.07 - chunked JSON REST API - /api/status and /api/sensors
+ * 1.08 - on-flash delta encoded reading history with /api/history
+ * 1.09 - store-and-forward spool with rate limited replay
+ * 1.10 - QoS 1 publishing with an in-flight window, durable sessions
+ * 1.11 - asynchronous MQTT client on ESPAsyncTCP replaces PubSubClient
+ * 1.12 - MQTT over TLS with the session cached in RTC memory
+ * 1.13 - gzip and delta OTA images, /update-delta endpoint
+ * 1.14 - OTA update mode - sampling and sleep suspended, 160 MHz, report
+ * 1.15 - CPU frequency governor with workload hints and time accounting
+ * 1.16 - oversampled, calibrated battery reading and battery-aware sleep
+ * 1.17 - adaptive sample and sleep interval from the temperature slope
+ * 1.18 - Home Assistant MQTT discovery, republished only on changes
+ * 1.19 - status message sent in full only when its content changes
+ * 1.20 - relay switched from the MQTT callback, ack topic and latency histogram
+ * 1.21 - log2 latency histograms for the main operations
+ * 1.22 - debounced interrupt driven inputs, cached relay state
+ * 1.23 - RSSI ranked AP selection with an RTC cached BSSID and roaming
+ * 1.24 - broker address cached in RTC memory, mDNS broker discovery
+ * 1.25 - I2C sensor driver registry, conversions overlapped with the DS18B20
+ * 1.26 - temperatures kept as raw 1/16 degC, formatted in fixed point
  * 
  ***********************************************************************/
 
 #include "main.h"
 
 // VERSION #define goes here
-#define VERSION "1.01"
+#define VERSION "1.26"
 #define PRG_NAME "ESP8266_MQTT_TEMP"
 extern const char version[] = VERSION;
 extern const char prgName[] = PRG_NAME;
@@ -50,14 +75,17 @@ void setup() {
   digitalWrite(LED_BUILT_IN_AUX, 0);  // turn off LED
 
   runTimer = millis();
+  telemetryInit();      // reset the memory health watermarks
   // use the following to keep ESP8266 running after wake-up
-  pinMode(GPIO0, OUTPUT);     // configure GPIO0 as output pin
+  relayInit(RELAY);           // configure GPIO0 as the relay output
+  strncpy(status.relay, relayStateName(), sizeof(status.relay));
   //pinMode(GPIO2, OUTPUT);     // configures GPIO2 as output pin
   //digitalWrite(GPIO0, HIGH);  // keeps CH_PD set high - chip enabled
   //digitalWrite(GPIO2, LOW);   // initialize GPIO2 to LOW
 
   // setup GPIO14 to bypass deep sleep with a pulldown
-  pinMode(GPIO14, INPUT_PULLUP);   // set GPIO14 as input with pullup
+  inputAttach(INPUT_SLEEP, NOT_NO_SLEEP, INPUT_PULLUP);  // input with pullup
+  inputsOnChange(inputEvent);
 
   Serial.begin(SERIAL_BAUD); // Start the Serial communication to send messages to the computer
   delay(1000);
@@ -68,6 +96,10 @@ void setup() {
   Serial.print(reason);
   Serial.println(" ***\r\n");
 
+  countersInit(false);  // load the error counters saved in RTC memory
+  governorInit(false);  // 80 MHz until a subsystem asks for more
+  batteryInit(false);   // battery filter state carried over deep sleep
+  adaptiveInit(false);  // temperature slope carried over deep sleep
   switch (reason.charAt(0)) {
     // Deep Sleep Wake
     case 'D': {
@@ -80,7 +112,13 @@ void setup() {
     case 'P': {
       // reset the msg count in RTC memory
       status.msgCount = 0;
-      ESP.rtcUserMemoryWrite(4, &status.msgCount, sizeof(status.msgCount));
+      ESP.rtcUserMemoryWrite(RTC_MSG_COUNT, &status.msgCount, sizeof(status.msgCount));
+      countersInit(true);   // reset the error counters
+      governorInit(true);   // and the time at each CPU frequency
+      batteryInit(true);    // and the battery filter
+      adaptiveInit(true);   // and the temperature slopes
+      discoveryReset();     // announce the sensors to Home Assistant again
+      statusReset();        // and send the first status in full
       status.runTime = 0;
       updateRunTime();
       Serial.printf("\r\n++++ Power - runTime= %lu ++++\r\n", status.runTime);
@@ -92,7 +130,7 @@ void setup() {
       break;
     }
   }
-  sleep = digitalRead(GPIO14);   // true - deep sleep, false - no sleep
+  sleep = inputLevel(INPUT_SLEEP);   // true - deep sleep, false - no sleep
   if (!sleep) {
     Serial.println("***SLEEP DISABLED***");
 
@@ -122,15 +160,23 @@ void setup() {
 
   Serial.println("...Starting I2C...");
   Wire.begin(SDA, SCL);
-  delay(1000);
+  // probe the I2C drivers - they power up in a few ms, no need to wait
+  Serial.printf("I2C sensors: %i of %u found\r\n", i2cSensors.begin(),
+                (unsigned)I2cSensors::COUNT);
 
   // initialize the One Wire temperature sensor interface
   oneWireInit();
+  for (int i = 0; i < MAX_DEVICES; i++) status.tempRaw[i] = TEMP_RAW_INVALID;
 
   // Initialize and connect to WiFi
   Serial.println("...connecting WiFi...");
   WiFi_Init();  // connect to WiFi
 
+  // mount the filesystem and start the on-flash reading history
+  historyInit();
+  otaModeInit();  // report of an update made before this restart
+  spoolInit();    // messages spooled during a broker outage
+
   // Initialize Over the Air update handler
   OTA_Init();
 
@@ -139,26 +185,99 @@ void setup() {
 
   //+++++++++++++++++++++++++++++
   //Setup the MQTT functions
-  // connect to broker passing pointers to the PubSubClinet and Config struct
-  if (!connectMqtt()) {
-    updateRunTime();
-    Serial.printf("\r\n++++ MQTT 1 - runTime= %lu ++++\r\n", status.runTime);
-    ESP.restart();  // restart if not connected
+  // connect to broker - if it is down keep sampling and spool the
+  // messages to flash, loop() keeps trying to reconnect
+  mqttOnConnect(mqttConnectEvent);
+  mqttOnDisconnect(mqttLostEvent);
+  mqttOnMessage(mqttMessageEvent);
+  // a deep sleep wake has nothing to do until the broker answers
+  if (!startMqtt(true) || (sleep && !mqttWaitConnected(timeout))) {
+    Serial.println("...MQTT offline - spooling messages until the broker returns...");
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to start connecting to the broker
+ * - the connect completes in mqttConnectEvent() or mqttLostEvent()
+ * - lookup is only set from setup(), see connectMqtt()
+ *-------------------------------------------------------------------------*/
+bool startMqtt(bool lookup) {
+  if (!connectMqtt(lookup)) {
+    countersIncrement(COUNT_MQTT_RECONNECT);
+    return false;
+  }
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function called when the broker accepts the connection
+ * - subscribes to the input topic unless a resumed durable session
+ *   still holds the subscription
+ *-------------------------------------------------------------------------*/
+void mqttConnectEvent(bool resumed) {
+  reconnectDelay = MQTT_RECONNECT_MIN;
+  if (otaReportFormat(outMsg, sizeof(outMsg), status.host)) {
+    Serial.printf("[%s] %s\n", mqttTopic(TOPIC_METRICS), outMsg);
+    publish(mqttTopic(TOPIC_METRICS), outMsg);
   }
+  // Home Assistant configs, only when the sensors or firmware changed
+  discoveryPublish(tempSensor, numDevices, [](const char *topic, const char *msg) {
+    return mqttPublish(topic, msg, QOS_0, true);
+  });
+  if (resumed) return;
 
-  if (!mqttClient.subscribe(inTopic, QOS_1)) {  // subscribe to the input topic
-    Serial.println("ERROR: Subscribe to '/cmd' failed - Resarting");
-    updateRunTime();
-    Serial.printf("\r\n++++ MQTT 2 - runTime= %lu ++++\r\n", status.runTime);
-    ESP.restart();
-  };
+  if (!mqttSubscribe(inTopic, QOS_1)) {  // subscribe to the input topic
+    Serial.println("ERROR: Subscribe to '/cmd' failed");
+    mqttDisconnect();
+    return;
+  }
   Serial.println("...MQTT subscribed to '/cmd'...");
 }
 
+/*-------------------------------------------------------------------------
+ * Function called with each message received
+ * - relay commands on inTopic are switched here, without waiting for
+ *   loop(), and acknowledged on the ack topic
+ *-------------------------------------------------------------------------*/
+void mqttMessageEvent(char* topic, byte* payload, unsigned int length) {
+  RelayAck ack;
+  if (strcmp(topic, inTopic) == 0 && relayCommand(payload, length, mqttRxMicros(), ack)) {
+    static char ackMsg[96];     // outMsg may be in use by loop()
+    strncpy(status.relay, relayStateName(), sizeof(status.relay));
+    snprintf(ackMsg, sizeof(ackMsg), "{\"%s\":{\"id\":\"%s\",\"relay\":\"%s\",\"us\":\"%u\"}}",
+             status.host, ack.id, ack.on ? "ON" : "OFF", ack.latencyUs);
+    if (!mqttPublish(mqttTopic(TOPIC_ACK), ackMsg, QOS_1, false)) {
+      mqttPublish(mqttTopic(TOPIC_ACK), ackMsg, QOS_0, false);  // window full
+    }
+    Serial.printf("RELAY %s in %u us\r\n", ack.on ? "ON" : "OFF", ack.latencyUs);
+  }
+  mqttCallback(topic, payload, length);   // log it and flag it for loop()
+}
+
+/*-------------------------------------------------------------------------
+ * Function called when a debounced input changes level
+ *-------------------------------------------------------------------------*/
+void inputEvent(InputId id, bool level) {
+  if (id == INPUT_SLEEP) {
+    sleep = level;
+    Serial.printf("...deep sleep %s...\r\n", sleep ? "enabled" : "disabled");
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function called when the connection is lost or a connect fails
+ *-------------------------------------------------------------------------*/
+void mqttLostEvent(int state) {
+  Serial.print("ERROR: Connection lost - ");
+  Serial.print("MQTT Connection State= ");
+  Serial.println(mqttState());
+  countersIncrement(COUNT_MQTT_RECONNECT);
+  reconnectTimer = millis();
+}
+
 unsigned long previousTime = millis();
 const unsigned long interval = 500;
 int led = LED_BUILT_IN_AUX;
-bool otaInProgress = false;
 
 //+++++++++++++++++++++++++++++++++
 // the main execution loop
@@ -166,67 +285,63 @@ void loop() {
   // initialize to force operations in first pass through loop
   unsigned long statusTimer = millis() + STATUS_INTERVAL; // status timer
   unsigned long tempTimer = millis() + TEMP_INTERVAL;   // temp interval timer
+  unsigned long tempInterval = TEMP_INTERVAL;           // adapted after each sample
+  bool sampling = false;          // conversions running, results not read yet
+  unsigned long sampleReady = 0;  // millis() when every conversion is done
+  uint32_t sampleStart = 0;       // micros() of the conversion request
+  unsigned long metricsTimer = millis() + METRICS_INTERVAL; // metrics timer
   //unsigned long tempTimer = millis();   // temp interval timer
+  uint32_t passStart = micros();  // start of this pass through the loop
+  uint32_t opStart;               // start of a timed operation
 
   //++++++++++++++++
   // loop forever
   while(1) {
-    // check sleep disable input pin
-    sleep = digitalRead(GPIO14);   // true - deep sleep, false - no sleep
+    histRecordSince(HIST_LOOP, passStart);
+    passStart = micros();
+    telemetryLoopTick();          // count loop iterations for the metrics
+    // debounce the input edges - inputEvent() updates sleep
+    inputsLoop();
     delay(1);
     // check for OTA updates
+    opStart = micros();
     ArduinoOTA.handle();
+    histRecordSince(HIST_OTA_HANDLE, opStart);
+    otaModeLoop();              // update mode for web uploads
+    if (!sleep) wifiApLoop();   // always-on nodes roam to a stronger AP
+    governorLoop();             // back to 80 MHz once the work is done
     delay(1);
 
-    if(!otaInProgress) {
-      // process MQTT incoming messages by running PubSubClient.loop()
-      if (!mqttClient.loop()) {
-        Serial.print("ERROR: Connection lost");
-        Serial.print("MQTT Connection State= ");
-        Serial.println(mqttState());
-        ESP.restart();
+    // no sampling, publishing or sleeping while an image comes in
+    if(!otaModeActive()) {
+      // service the MQTT connection - the packets themselves are handled
+      // as they arrive, mqttLoop() only keeps the session alive
+      opStart = micros();
+      bool online = mqttLoop();
+      histRecordSince(HIST_MQTT_LOOP, opStart);
+      if (online) {
+        // replay any messages spooled during an outage, rate limited -
+        // a deep sleep node sends its first batch of the wake at once
+        spoolReplay(publishSpooled, sleep);
+      }
+      // reconnect with an exponential backoff while the broker is down
+      else if (!mqttConnecting() && millis() - reconnectTimer > reconnectDelay) {
+        reconnectTimer = millis();
+        startMqtt(false);
+        // mqttConnectEvent() resets the delay once the broker answers
+        reconnectDelay = min(reconnectDelay * 2, MQTT_RECONNECT_MAX);
+        Serial.printf("...MQTT retry in %lu s...\r\n", reconnectDelay / 1000);
       }
 
       //+++++++++++++++++++++++++++++++++
       // handle any new messages received
       if (newMsgFlag) {
-        if (strcmp(rcvTopic, inTopic) == 0) {
-          // this is a valid inTopic message
-          // now act on the message if it is "ON"
-          if (strcmp(rcvMsg, "ON") == 0) {
-            digitalWrite(RELAY, HIGH);
-            strncpy(status.relay, "ON", sizeof(status.relay));
-            Serial.println("RELAY ON");
-          }
-          // now act on the message if it is "OFF"
-          else if (strcmp(rcvMsg, "OFF") == 0) {
-            digitalWrite(RELAY, LOW);
-            strncpy(status.relay, "OFF", sizeof(status.relay));
-            Serial.println("RELAY OFF");
-          }
-          // now act on the message if it is "TOGGLE"
-          else if (strcmp(rcvMsg, "TOGGLE") == 0) {
-            if(digitalRead(RELAY)) {
-              digitalWrite(RELAY, LOW);
-              strncpy(status.relay, "OFF", sizeof(status.relay));
-              Serial.println("RELAY OFF");
-            }
-            else {
-              digitalWrite(RELAY, HIGH);
-              strncpy(status.relay, "ON", sizeof(status.relay));
-              Serial.println("RELAY ON");
-            }
-          }
-        }
-
-        // read the current pin state
-        if (digitalRead(RELAY)) {
-            strncpy(status.relay, "ON", sizeof(status.relay));
-        }
-        else {
-            strncpy(status.relay, "OFF", sizeof(status.relay));
+        // relay commands were already acted on in mqttMessageEvent(),
+        // which also updated status.relay
+        if (strcmp(rcvTopic, inTopic) == 0 && strncmp(rcvMsg, "HIST", 4) == 0) {
+          publishHistograms(outMsg, sizeof(outMsg));
+          if (strcmp(rcvMsg, "HIST RESET") == 0) histReset();
         }
-
         // publish the MQTT status message
         publishMsg1(outMsg);
         newMsgFlag = false;           // reset newMsgFlag
@@ -236,46 +351,58 @@ void loop() {
       //+++++++++++++++++++++++++++++++++++
       //Temperature sensor execution block
       // call sensors.requestTemperatures() to issue a global temperature
-      // request to all devices on the bus
-      if (millis() - tempTimer > TEMP_INTERVAL) {
+      // request to all devices on the bus, then start the I2C drivers so
+      // all the conversions run together - the loop keeps going meanwhile
+      if (!sampling && millis() - tempTimer > tempInterval) {
         tempTimer = millis();       // reset the timer
-        //Serial.print("Requesting temperatures...");
-        sensors.requestTemperatures(); // Send the command to get temperatures
-        //Serial.println("DONE");
-        // It responds almost immediately. Let's print out the data
+        sampleStart = micros();
+        sensors.requestTemperatures(); // returns at once, see oneWireInit()
+        uint16_t waitMs = max(tempConversionMs, i2cSensors.start());
+        sampleReady = millis() + waitMs;
+        sampling = true;
+      }
+      // read every sensor once the slowest conversion is done
+      if (sampling && (long)(millis() - sampleReady) >= 0) {
+        sampling = false;
+        histRecordSince(HIST_TEMP_CONVERT, sampleStart);
 
         // Use a simple function to print and return sensor temperature
+        opStart = micros();
         for (int i = 0; i < numDevices; i++) {
           Serial.printf("Sensor %i - ", i);
-          status.DegC[i] = printTemperature(tempSensor[i]);
-          status.DegF[i] = DallasTemperature::toFahrenheit(status.DegC[i]);
+          status.tempRaw[i] = printTemperature(tempSensor[i], status.tempErrors[i]);
         }
+        numReadings = i2cSensors.read(readings);
+        histRecordSince(HIST_TEMP_READ, opStart);
         //status.vcc = ((float)ESP.getVcc()/1024);
-        int a0 = analogRead(A0);
-        status.vcc = (float)a0 * volts_per_step;
-        //status.vcc = analogRead(A0);
-        Serial.printf("Vcc = %.2f - %i\r\n", status.vcc, a0);
+        status.vcc = batteryRead() / 1000.0f;
+        status.battery = batteryPercent();
+        Serial.printf("Vcc = %.2f - %i%%\r\n", status.vcc, status.battery);
+
+        // push the new sample to any browsers watching /events
+        webEventsSendReadings();
+
+        // and keep it in the on-flash history
+        historyAppend(status.tempRaw, numDevices);
+
+        // sample sooner while the temperatures are moving
+        adaptiveUpdate(status.tempRaw, status.tempErrors, tempResolution, numDevices);
+        tempInterval = adaptiveAwakeMs();
       } // end temperature sensor execution block
 
       //+++++++++++++++++++++++++++++++
-      // if status timer expires - publish the current status
-      if (millis() - statusTimer > STATUS_INTERVAL) {
+      // if status timer expires - publish the current status, after the
+      // sample in progress so the readings are never stale
+      if (!sampling && millis() - statusTimer > STATUS_INTERVAL) {
         statusTimer = millis();       // reset the timer
 
-        if (mqttClient.connected()) {
+        if (mqttConnected()) {
           strncpy(status.wifi, "Online", sizeof(status.wifi));
         }
         else {
           strncpy(status.wifi, "Offline", sizeof(status.wifi));
         }
-
-        // read the current pin state
-        if (digitalRead(RELAY)) {
-          strncpy(status.relay, "ON", sizeof(status.relay));
-        }
-        else {
-            strncpy(status.relay, "OFF", sizeof(status.relay));
-        }
+        status.rssi = WiFi.RSSI();
 
         //++++++++++++++++++++++++++++++++++++++++++++++++
         // print to serial and publish the status messages
@@ -283,19 +410,39 @@ void loop() {
         publishMsg1(outMsg);
 
         publishTemps(outMsg, numDevices);
+        publishReadings(outMsg, sizeof(outMsg));
 
       } // end publish status execution block
-    } // !otaInProgress execution block
+
+      //+++++++++++++++++++++++++++++++
+      // if metrics timer expires - sample and publish memory health
+      if (millis() - metricsTimer > METRICS_INTERVAL) {
+        metricsTimer = millis();      // reset the timer
+        telemetrySample();
+        publishMetrics(outMsg, sizeof(outMsg));
+      } // end publish metrics execution block
+    } // !otaModeActive execution block
 
     //++++++++++++++++++++++++++++++++++++++++++++
-    // enter deep sleep here unless sleep is false
-    if(sleep) {
-      wifiClient.flush();   // ensure all data has been sent before sleep
+    // enter deep sleep here unless sleep is false, the input is still
+    // settling or a sample is still converting
+    if(sleep && !otaModeActive() && !inputsPending() && !sampling) {
+      // wait for the QoS 1 PUBACKs, spool whatever the broker did not ack
+      if (!mqttDrain(MQTT_DRAIN_MS)) {
+        int n = inflightTakeUnacked(spoolUnacked);
+        if (n) Serial.printf("...%i unacknowledged messages spooled...\r\n", n);
+      }
       Serial.println("*** Entering Deep Sleep ***");
       delay(5000);          // display temps for 5 seconds on OLED
       updateRunTime();
       Serial.printf("Run Time: %lu\r\n", status.runTime);
-      ESP.deepSleep(SLEEP_TIME_TEN_MINUTES);  // set deep sleep time
+      uint64_t sleepUs = batterySleepTime(adaptiveSleepUs());  // longer when low
+      historySleep(sleepUs / 1000000UL);  // save history and clock
+      brokerSleep(sleepUs / 1000000UL);   // broker address TTL without a clock
+      governorSleep();      // time at each CPU frequency this wake
+      batterySleep();       // battery filter state
+      adaptiveSleep(sleepUs);  // temperature slopes and the time asleep
+      ESP.deepSleep(sleepUs);  // set deep sleep time
       //ESP.deepSleep(SLEEP_TIME_SIXTY_SECONDS);  // set deep sleep time
     }
   } // OTA while loop block
@@ -307,31 +454,27 @@ void loop() {
 
 /*-------------------------------------------------------------------------
  * Function to print the temperature for a device and return sensor temp
+ * - returns the raw reading in 1/16 degC, TEMP_RAW_INVALID if the device
+ *   did not answer
  *-------------------------------------------------------------------------*/
- float printTemperature(DeviceAddress deviceAddress) {
-   // method 1 - slower
-   //Serial.print("Temp C: ");
-   //Serial.print(sensors.getTempC(deviceAddress));
-   //Serial.print(" Temp F: ");
-   //Serial.print(sensors.getTempF(deviceAddress)); // Makes a second call to getTempC and then converts to Fahrenheit
-
-   // method 2 - faster
-   float tempC = sensors.getTempC(deviceAddress);
-   if(tempC == DEVICE_DISCONNECTED_C)
+ int16_t printTemperature(DeviceAddress deviceAddress, unsigned int &errors) {
+   // getTemp() returns the scratchpad value in 1/128 degC - no floats,
+   // unlike getTempC() and getTempF()
+   int32_t temp = sensors.getTemp(deviceAddress);
+   if(temp == DEVICE_DISCONNECTED_RAW)
    {
      Serial.println("Error: Could not read temperature data");
-     tempC = 0;
-     return tempC;
+     errors++;
+     return TEMP_RAW_INVALID;
    }
+   int16_t raw = temp >> 3;     // 1/16 degC, the DS18B20 resolution
 
-   Serial.print("Temp C: ");
-   Serial.print(tempC);
-   Serial.print(" Temp F: ");
-   // Convert tempC to Fahrenheit
-   float tempF = DallasTemperature::toFahrenheit(tempC);
-   Serial.println(tempF);
+   char tempC[12], tempF[12];
+   formatTempC(tempC, sizeof(tempC), raw);
+   formatTempF(tempF, sizeof(tempF), raw);
+   Serial.printf("Temp C: %s Temp F: %s\r\n", tempC, tempF);
 
-   return tempC;
+   return raw;
  }
 
  /**********************************************************
@@ -346,42 +489,74 @@ void loop() {
  }
 
 /*-------------------------------------------------------------------------
- * Function to publish an MQTT message to outTopic
+ * Function to publish an MQTT message
+ * - outTopic messages are spooled to flash when they can not be sent, and
+ *   while older spooled messages are waiting, so they stay in order
+ * - other messages are dropped while the broker is unreachable
  *-------------------------------------------------------------------------*/
-void publish(char* topic, char* msg) {
-  // publish the MQTT message, else print error message and restart the ESP01
-  if (!mqttClient.publish(topic, msg)) {
+void publish(const char* topic, const char* msg) {
+  bool spoolable = strcmp(topic, outTopic) == 0;
+  uint8_t qos = spoolable ? config.mqttQos : QOS_0;
+  // a full QoS 1 window is a slow broker, not a reason to wait for it
+  if (spoolable && (spoolPending() || (qos != QOS_0 && inflightFull()))) {
+    spoolPush(msg, historyNow());
+    return;
+  }
+  if (mqttConnected()) {
+    if (mqttPublish(topic, msg, qos, false)) return;
+
+    // the send buffer is full - the keep alive finds a dead connection
     Serial.printf("ERROR: failed to send '%s' message\n", msg);
-    Serial.print("MQTT Connection State= ");
-    Serial.println(mqttState());
-    // if connected - disonnect if we got here
-    if (mqttClient.connected()) mqttClient.disconnect();
-    updateRunTime();
-    Serial.printf("\r\n++++ MQTT 3 - runTime= %lu ++++\r\n", status.runTime);
-    ESP.restart();
+    countersIncrement(COUNT_PUBLISH_FAIL);
   }
+  if (spoolable) spoolPush(msg, historyNow());
+}
+
+/*-------------------------------------------------------------------------
+ * Function to publish one spooled message to outTopic during replay
+ *-------------------------------------------------------------------------*/
+bool publishSpooled(const char* msg) {
+  Serial.printf("[%s] replay %s\n", outTopic, msg);
+  return mqttPublish(outTopic, msg, config.mqttQos, false);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to spool a QoS 1 message left unacknowledged at deep sleep
+ *-------------------------------------------------------------------------*/
+void spoolUnacked(const char* topic, const char* msg) {
+  if (strcmp(topic, outTopic) == 0) spoolPush(msg, historyNow());
 }
 
 /*------------------------------------------------------------------------
  * Function to assemble and publish the MQTT status message
  *------------------------------------------------------------------------*/
 void publishMsg1(char msg[]) {
+  // skip the message when nothing but the count changed
+  uint32_t hash = statusHash(version, status.wifi, status.relay);
+  StatusSend kind = statusCheck(hash, status.rssi);
+  if (kind == STATUS_SKIP) return;
 
-  // get the saved message count from RTC memory offset 4
-  ESP.rtcUserMemoryRead(4, &status.msgCount, sizeof(status.msgCount));
+  // get the saved message count from RTC memory
+  ESP.rtcUserMemoryRead(RTC_MSG_COUNT, &status.msgCount, sizeof(status.msgCount));
   status.msgCount++;
-  ESP.rtcUserMemoryWrite(4, &status.msgCount, sizeof(status.msgCount));
+  ESP.rtcUserMemoryWrite(RTC_MSG_COUNT, &status.msgCount, sizeof(status.msgCount));
 
   /*sprintf(msg,
           "{\"%s\":{\"pgm\":\"%s\",\"version\":\"%s\",\"msg\":\"%u\",\"wifi\":\"%s\",\"rssi\":\"%i\",\"relay\":\"%s\"}}",
         status.host, prgName, version, status.msgCount, status.wifi, status.rssi, status.relay);
   */
-  sprintf(msg,
+  if (kind == STATUS_HEARTBEAT) {
+    sprintf(msg, "{\"%s\":{\"msg\":\"%u\"}}", status.host, status.msgCount);
+  }
+  else {
+    sprintf(msg,
           "{\"%s\":{\"version\":\"%s\",\"msg\":\"%u\",\"wifi\":\"%s\",\"rssi\":\"%i\",\"relay\":\"%s\"}}",
         status.host, version, status.msgCount, status.wifi, status.rssi, status.relay);
+  }
   // now publish it
   Serial.printf("[%s] %s\n", outTopic, outMsg);
   publish(outTopic, outMsg);    // publish the current status
+  statusSent(kind, hash, status.rssi);
   return;
 }
 
@@ -389,12 +564,22 @@ void publishMsg1(char msg[]) {
  * Function to assemble and publish the MQTT temp sensor messages
  *------------------------------------------------------------------------*/
 void publishTemps(char msg[], int devices) {
+  governorPulse(CPU_HINT_SERIALIZE);
 
   for (int i = 0; i < devices; i++) {
     //updateRunTime();
+    // degC and degF are only made here, from the raw reading - left out
+    // after a failed read so subscribers keep the last value
+    char temps[48] = "";
+    if (status.tempRaw[i] != TEMP_RAW_INVALID) {
+      char degC[12], degF[12];
+      formatTempC(degC, sizeof(degC), status.tempRaw[i]);
+      formatTempF(degF, sizeof(degF), status.tempRaw[i]);
+      snprintf(temps, sizeof(temps), "\"Deg%iC\":\"%s\",\"Deg%iF\":\"%s\",", i, degC, i, degF);
+    }
     // assemble temp sensor MQTT messages
-    sprintf(msg,"{\"%s\":{\"Deg%iC\":\"%.2f\",\"Deg%iF\":\"%.2f\",\"vcc\":\"%.2f\",\"run\":\"%lu\"}}",
-          status.host, i, status.DegC[i], i, status.DegF[i], status.vcc, status.runTime);
+    sprintf(msg,"{\"%s\":{%s\"vcc\":\"%.2f\",\"run\":\"%lu\"}}",
+          status.host, temps, status.vcc, status.runTime);
     // now publish it
     Serial.printf("[%s] %s\n", outTopic, outMsg);
     publish(outTopic, outMsg);    // publish the current pin state
@@ -404,6 +589,77 @@ void publishTemps(char msg[], int devices) {
 }
 
 
+/*------------------------------------------------------------------------
+ * Function to assemble and publish the MQTT I2C sensor messages
+ * - one message per driver, e.g. {"host":{"sht3x_temp":"21.30",...}}
+ *------------------------------------------------------------------------*/
+void publishReadings(char msg[], size_t len) {
+  governorPulse(CPU_HINT_SERIALIZE);
+
+  size_t i = 0;
+  while (i < numReadings) {
+    if (!readings[i].valid) {           // failed or never read
+      i++;
+      continue;
+    }
+    // readings of one driver share the name up to the '_', a name
+    // without one is a group of its own (the NUL has to match too)
+    const char *name = readings[i].name;
+    const char *sep = strchr(name, '_');
+    size_t prefix = sep ? sep - name + 1 : strlen(name) + 1;
+    int n = snprintf(msg, len, "{\"%s\":{", status.host);
+    for (size_t first = i; i < numReadings && readings[i].valid &&
+                           strncmp(readings[i].name, name, prefix) == 0; i++) {
+      char value[16];
+      readingFormat(value, sizeof(value), readings[i]);
+      n += snprintf(msg + n, n < (int)len ? len - n : 0, "%s\"%s\":\"%s\"",
+                    i == first ? "" : ",", readings[i].name, value);
+    }
+    n += snprintf(msg + n, n < (int)len ? len - n : 0, "}}");
+    if (n >= (int)len) {
+      Serial.println("ERROR: readings message truncated");
+      continue;
+    }
+    Serial.printf("[%s] %s\n", outTopic, msg);
+    publish(outTopic, msg);
+  }
+  return;
+}
+
+
+/*------------------------------------------------------------------------
+ * Function to assemble and publish the MQTT memory health message
+ *------------------------------------------------------------------------*/
+void publishMetrics(char msg[], size_t len) {
+  governorPulse(CPU_HINT_SERIALIZE);
+  if (telemetryFormat(msg, len, status.host) >= (int)len) {
+    Serial.println("ERROR: metrics message truncated");
+    return;
+  }
+  Serial.printf("[%s] %s\n", mqttTopic(TOPIC_METRICS), msg);
+  publish(mqttTopic(TOPIC_METRICS), msg);
+  return;
+}
+
+/*------------------------------------------------------------------------
+ * Function to publish a snapshot of the latency histograms
+ * - one message per operation, times in microseconds
+ * - sent for a "HIST" command, "HIST RESET" also clears them
+ *------------------------------------------------------------------------*/
+void publishHistograms(char msg[], size_t len) {
+  for (int i = 0; i < HIST_COUNT; i++) {
+    HistId id = (HistId)i;
+    snprintf(msg, len,
+             "{\"%s\":{\"op\":\"%s\",\"n\":\"%u\",\"p50\":\"%u\",\"p99\":\"%u\",\"max\":\"%u\"}}",
+             status.host, histNames[i], histograms[i].count, histPercentile(id, 50),
+             histPercentile(id, 99), histograms[i].maxUs);
+    Serial.printf("[%s] %s\n", mqttTopic(TOPIC_METRICS), msg);
+    publish(mqttTopic(TOPIC_METRICS), msg);
+  }
+  return;
+}
+
+
 /*-----------------------------------------------------------------------
  * Function to update the runTime variable stored in RTC memory
  * - adds current millis() value to runTime and saves to RTC memory
@@ -419,7 +675,7 @@ void updateRunTime() {
   //Serial.printf("\r\n++++ Upper - runTime= %i ++++\r\n", upper);
   //Serial.printf("\r\n++++ Lower - runTime= %i ++++\r\n", lower);
   //ESP.rtcUserMemoryWrite(8, &upper, sizeof(upper));
-  ESP.rtcUserMemoryWrite(12, &lower, sizeof(lower));
+  ESP.rtcUserMemoryWrite(RTC_RUN_TIME, &lower, sizeof(lower));
   return;
 }
 
@@ -433,7 +689,7 @@ unsigned long getSavedRunTime() {
   uint32_t lower;
   unsigned long time;
   //ESP.rtcUserMemoryRead(8, &upper, sizeof(upper));
-  ESP.rtcUserMemoryRead(12, &lower, sizeof(lower));
+  ESP.rtcUserMemoryRead(RTC_RUN_TIME, &lower, sizeof(lower));
   //time = (unsigned long)upper;  // assign upper data bits
   //time = time << 32;  // now shift upper data bits to high 32 bits
   //time = time | lower;  // now OR the lower data bits 
@@ -506,9 +762,17 @@ void oneWireInit() {
     sensors.setResolution(tempSensor[i], 9);
 
     Serial.printf("Device %i Resolution: ", i);
-    Serial.print(sensors.getResolution(tempSensor[i]), DEC);
+    tempResolution[i] = sensors.getResolution(tempSensor[i]);
+    Serial.print(tempResolution[i], DEC);
     Serial.println();
   }
+
+  // start conversions without blocking - loop() waits for the slowest
+  // device together with the I2C sensors
+  uint8_t maxResolution = 9;
+  for (int i = 0; i < numDevices; i++) maxResolution = max(maxResolution, tempResolution[i]);
+  tempConversionMs = sensors.millisToWaitForConversion(maxResolution);
+  sensors.setWaitForConversion(false);
 }
 
 //++++++++++++++++++++++++++++++++++++
@@ -521,35 +785,21 @@ void elegantOTA_Init() {
         request->send(404, "text/plain", "404 - Page Not Found, oops!");
       });
   
-  // Send back a web page (landing page)
-  server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-    // Tell the system that we will be sending back html (not just plain text)
-    AsyncResponseStream *response = request->beginResponseStream("text/html");
-
-    // Format the html as a RAW literal so we don't have to escape all the quotes (and more)
-    response->printf(R"(
-      <html>
-        <head>
-          <title>Landing Page</title>
-          <style>
-            body {
-              background-color: forestgreen;
-              font-family: Arial, Sans-Serif;
-            }
-          </style>
-        </head>
-        <body>
-          <h1>Landing Page</h1>
-          <p>
-            This is a descriptive paragraph for your landing page
-          </p>
-        </body>
-      </html>
-    )");
-
-    // Send back all the text/html for a standard web page
-    request->send(response);
-  });
+  // Send back the landing page and any other pre-compressed web assets
+  webAssetsInit(&server);
+
+  // Prometheus scrape endpoint
+  webMetricsInit(&server);
+
+  // read-only JSON REST API
+  webApiInit(&server);
+  webHistoryInit(&server);
+
+  // Server-Sent Events stream of live readings
+  webEventsInit(&server);
+
+  // firmware delta upload next to ElegantOTA's full image /update
+  webDeltaInit(&server);
 
   // Starting Async OTA web server AFTER all the server.on requests registered
   AsyncElegantOTA.begin(&server);
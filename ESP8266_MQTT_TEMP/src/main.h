@@ -5,15 +5,32 @@
 // Local includes
 #include "WiFi_Init.h"
 #include "OTA_Init.h"
+#include "topics.h"
+#include "telemetry.h"
+#include "rtcmem.h"
+#include "web.h"
+#include "history.h"
+#include "spool.h"
+#include "inflight.h"
+#include "otamode.h"
+#include "governor.h"
+#include "battery.h"
+#include "adaptive.h"
+#include "discovery.h"
+#include "statusmsg.h"
+#include "relay.h"
+#include "histogram.h"
+#include "inputs.h"
+#include "wifiap.h"
+#include "i2cbus.h"
+#include "i2csensors.h"
+#include "fixedpoint.h"
+#include "broker.h"
 
 // Library includes required for this program
 #include <Arduino.h>    // required for VSC & PlatformIO
 #include <Wire.h>       // common library for I2C devices
 #include <ESP8266WiFi.h> // for NodeMCU and ESP8266 ethernet modules
-#include <ESP8266WiFiMulti.h>
-// Create an instance of the ESP8266WiFiMulti class, called 'wifiMulti'
-ESP8266WiFiMulti wifiMulti;
-#include <PubSubClient.h>   // MQTT client library header
 
 // Libraries for Web Services
 #include <ESPAsyncTCP.h>       // library used with ESP8266
@@ -40,12 +57,8 @@ AsyncWebServer server(80);
 
 //+++++++++++++++++++++++++++++
 // analog pin configuration
-// battery voltage divider = 100K/540K = 0.1852
-// max 1V range = 1/.1852 = 5.3995
-// 1024 steps - 0.0053 volts/step
-// actual measured is closer to 0.0051 or 5.15/1024
+// A0 reads the battery divider - see battery.h
 // ADC_MODE(ADC_VCC);
-const float volts_per_step = 5.15/1024;
 
 //++++++++++++++++++++++++++++++++++++
 // One Wire bus and temperature probe libraries
@@ -53,7 +66,7 @@ const float volts_per_step = 5.15/1024;
 #include <DallasTemperature.h>
 // temperature sensor defines and variables
 #define ONE_WIRE_BUS 2        // GPIO2 (D4) One Wire bus interface
-#define TEMP_INTERVAL 10000UL
+#define TEMP_INTERVAL 10000UL   // first sample, then see adaptive.h
 #define MAX_DEVICES 5
 int numDevices = 0;
 
@@ -65,6 +78,18 @@ DallasTemperature sensors(&oneWire);
 
 // arrays to hold device address
 DeviceAddress tempSensor[MAX_DEVICES];
+// resolution of each device in bits, read once by oneWireInit()
+uint8_t tempResolution[MAX_DEVICES];
+// DS18B20 conversion time at the highest resolution on the bus
+uint16_t tempConversionMs = 750;
+
+//++++++++++++++++++++++++++++++++++++
+// I2C sensors - the drivers fitted to this build, see i2csensors.h
+WireBus i2cBus(Wire);
+typedef SensorSet<WireBus, Sht3x, Bmp280, Ads1115> I2cSensors;
+I2cSensors i2cSensors(i2cBus);
+Reading readings[I2cSensors::CHANNELS];   // latest sample, list order
+size_t numReadings = 0;
 
 //++++++++++++++++
 // deep sleep variables
@@ -76,25 +101,22 @@ unsigned long runTimer = 0;
 
 // MQTT defines
 #define STATUS_INTERVAL 30000UL   // online message interval
-#define QOS_0 0
-#define QOS_1 1
-#define QOS_2 2
+#define MQTT_RECONNECT_MIN 5000UL     // first reconnect attempt after a loss
+#define MQTT_RECONNECT_MAX 300000UL   // reconnect backoff limit
+unsigned long reconnectTimer = 0;               // MQTT reconnect timer
+unsigned long reconnectDelay = MQTT_RECONNECT_MIN;  // backoff delay
+#define MQTT_DRAIN_MS 3000UL      // wait for PUBACKs before deep sleep
 
 extern Config config;  // declare the external configuration struct
 extern Status status;  // declare the external status struct
-extern WiFiClient wifiClient;   // declare the external WiFiClient object
-extern PubSubClient mqttClient;    // declare the external PubSubClient object
 
-extern const char topicPreamble[];
-extern const char will[];
 extern int willQoS;         // use QoS = 1 for last will message
 extern bool willRetain;     // retain the last will
 extern bool cleanSession;   // true = start fresh; false = durable
-extern const char cmd[];
-extern const char statusTopic[];
-extern char willTopic[40];
-extern char inTopic[40];
-extern char outTopic[40];
+extern bool sessionPresent; // broker kept the session from the last wake
+extern char * const willTopic;  // topic paths built by mqttTopicInit()
+extern char * const inTopic;
+extern char * const outTopic;
 extern char willMessage[128];
 extern char outMsg[128];
 extern char rcvMsg[256];    //message receive buffer
@@ -106,19 +128,41 @@ extern const unsigned long keepAlive;
 extern const unsigned long timeout;
 
 // Forward function definitions
-extern bool connectMqtt();
+extern bool connectMqtt(bool lookup);
 extern void mqttTopicInit();
 extern void mqttCallback(char* topic, byte* payload, unsigned int length);
 extern int mqttState();
-extern void publish(char* topic, char* msg);
+extern bool mqttConnected();
+extern bool mqttConnecting();
+extern void mqttDisconnect();
+extern bool mqttLoop();
+extern bool mqttPublish(const char* topic, const char* msg, uint8_t qos, bool retain);
+extern bool mqttSubscribe(const char* topic, uint8_t qos);
+extern bool mqttDrain(unsigned long timeoutMs);
+extern bool mqttWaitConnected(unsigned long timeoutMs);
+extern void mqttOnConnect(void (*fn)(bool sessionPresent));
+extern void mqttOnDisconnect(void (*fn)(int state));
+extern void mqttOnMessage(void (*fn)(char* topic, byte* payload, unsigned int length));
+extern uint32_t mqttRxMicros();
+extern void publish(const char* topic, const char* msg);
 
 // forward function definitions
 void oneWireInit();
 void elegantOTA_Init();
-float printTemperature(DeviceAddress deviceAddress);
+int16_t printTemperature(DeviceAddress deviceAddress, unsigned int &errors);
 void printAddress(DeviceAddress deviceAddress);
 void publishMsg1(char msg[]);
 void publishTemps(char msg[], int devices);
+void publishReadings(char msg[], size_t len);
+void publishMetrics(char msg[], size_t len);
+void publishHistograms(char msg[], size_t len);
+bool publishSpooled(const char* msg);
+void spoolUnacked(const char* topic, const char* msg);
+bool startMqtt(bool lookup);
+void mqttConnectEvent(bool resumed);
+void mqttLostEvent(int state);
+void mqttMessageEvent(char* topic, byte* payload, unsigned int length);
+void inputEvent(InputId id, bool level);
 void updateRunTime();
 unsigned long getSavedRunTime();
 
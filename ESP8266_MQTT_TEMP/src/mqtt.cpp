@@ -4,60 +4,239 @@
 extern Config config;  // declare the external configuration struct
 extern Status status;  // declare the external status struct
 
+//++++++++++++++++++++++
+// Connection state - the transport events arrive from the network stack
+// between passes of loop(), everything else runs from loop()
+enum MqttPhase { PHASE_IDLE, PHASE_TCP, PHASE_CONNACK, PHASE_CONNECTED };
+
+static const MqttTransport *transport = &asyncTransport;
+static MqttPhase phase = PHASE_IDLE;
+static int lastState = MQTT_DISCONNECTED;
+static MqttDecoder decoder;               // received packet framing
+static uint8_t txBuf[MQTT_TX_MAX];        // packet being sent
+static unsigned long phaseStart = 0;      // connect attempt started
+static unsigned long lastOut = 0;         // last packet sent
+static unsigned long lastIn = 0;          // last bytes received
+static unsigned long pingSent = 0;
+static bool pingOutstanding = false;
+static uint16_t nextSubscribeId = 0;
+static uint32_t rxMicros = 0;       // micros() when the last bytes arrived
+static uint32_t connectMicros = 0;  // micros() when the connect started
+
+static void (*connectFn)(bool sessionPresent) = nullptr;
+static void (*disconnectFn)(int state) = nullptr;
+static void (*messageFn)(char* topic, byte* payload, unsigned int length) = mqttCallback;
+static void (*publishFn)(uint16_t packetId) = nullptr;
+
+/*-------------------------------------------------------------------------
+ * Function to hand a packet to the transport
+ * - never waits, a packet that does not fit in the transport's send
+ *   buffer is refused and the caller decides whether to retry or spool
+ *-------------------------------------------------------------------------*/
+static size_t sendPacket(const uint8_t *buf, size_t len) {
+  if (!len || transport->space() < len) return 0;
+  size_t n = transport->write(buf, len);
+  if (n == len) lastOut = millis();
+  return n;
+}
+
+// writer for the in-flight window - only on an established session
+static size_t sendSessionPacket(const uint8_t *buf, size_t len) {
+  return phase == PHASE_CONNECTED ? sendPacket(buf, len) : 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to drop the connection and report why
+ *-------------------------------------------------------------------------*/
+static void closeWith(int state) {
+  if (phase == PHASE_IDLE) return;
+  phase = PHASE_IDLE;           // before close() - it may call back
+  lastState = state;
+  transport->close();
+  if (disconnectFn) disconnectFn(state);
+}
+
 /*-------------------------------------------------------------------------
- * Function to initialize and connect to an MQTT broker defined in the
+ * Function to start connecting to the MQTT broker defined in the
  * configuration struct.
- * Notes: use the following default values from the PubSubClient library:
- *        MQTT_MAX_PACKET_SIZE = 128 bytes
- *        MQTT_KEEPALIVE = 15 seconds
+ * - returns as soon as the connect is under way, the result arrives
+ *   through the mqttOnConnect() and mqttOnDisconnect() callbacks
+ * - lookup lets brokerResolve() wait for a DNS or mDNS lookup, loop()
+ *   reconnects pass false and use the cached or last known address
+ * - MQTT_SECURE_ENABLE "t" connects over TLS, the TLS handshake is the
+ *   one step that blocks
+ * Notes: MQTT_RX_MAX and MQTT_TX_MAX = 512 bytes
+ *        keepAlive = 15 seconds
  *        MQTT_VERSION = MQTT 3.1.1
- *        MQTT_MAX_TRANSFER_SIZE = undefined (complete packet passed)
- *        MQTT_SOCKET_TIMEOUT = 15 seconds
+ *        timeout = 15 seconds for the connect and ping responses
  *-------------------------------------------------------------------------*/
-bool connectMqtt() {
-  bool mqttConnectedFlag = false;
-  // set the MQTT server and port
-  mqttClient.setServer(config.mqttServer, config.mqttPort);
-
-  // set the MQTT message received callback function
-  mqttClient.setCallback(mqttCallback);
+bool connectMqtt(bool lookup) {
+  if (phase != PHASE_IDLE) return phase == PHASE_CONNECTED;
 
   // initialize the MQTT topics for this device
   mqttTopicInit();
 
-  // now set up the last will topic with
-  // QoS = 1, willRetain = true, cleanSession = true
+  // QoS 1 packets go out through the same transport
+  static bool windowReady = false;
+  if (!windowReady) {
+    inflightInit(sendSessionPacket);
+    windowReady = true;
+  }
+  cleanSession = strcmp(config.mqttCleanSession, "f") != 0;
+  transport = strcmp(config.mqttSecureEnable, "t") == 0 ? &tlsTransport : &asyncTransport;
 
   // create the last will message
   sprintf(willMessage, "{\"%s\":{\"wifi\":\"Offline\"}}", status.host);
 
-  mqttConnectedFlag = mqttClient.connect(status.host,
-                      config.mqttUser,
-                      config.mqttPW,
-                      willTopic, willQoS, willRetain,
-                      willMessage, cleanSession);
-  // now report on connection status
-  if (mqttConnectedFlag) {
-    Serial.println("...MQTT broker connected...");
+  mqttDecoderReset(decoder);
+  pingOutstanding = false;
+  // the broker address, cached across wakes - see broker.h
+  IPAddress brokerIp;
+  uint16_t brokerPort;
+  connectMicros = micros();
+  if (!brokerResolve(brokerIp, brokerPort, lookup)) {
+    lastState = MQTT_CONNECT_FAILED;
+    return false;
   }
-  else {
+
+  phase = PHASE_TCP;
+  phaseStart = millis();
+  if (!transport->open(config.mqttServer, brokerIp, brokerPort)) {
+    brokerFailed();
+    phase = PHASE_IDLE;
+    lastState = MQTT_CONNECT_FAILED;
     Serial.print("...ERROR: MQTT connect failed - ");
     mqttState();
+    return false;
   }
+  Serial.printf("...MQTT connecting over %s...\r\n", transport->name);
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function called by the transport once the connection is open
+ * - sends CONNECT with the last will: QoS = 1, willRetain = true and
+ *   cleanSession from the configuration
+ *-------------------------------------------------------------------------*/
+void mqttTransportConnected() {
+  if (phase != PHASE_TCP) return;
+  MqttConnectOpts opts;
+  opts.clientId = status.host;
+  opts.user = config.mqttUser;
+  opts.password = config.mqttPW;
+  opts.willTopic = willTopic;
+  opts.willMessage = willMessage;
+  opts.willQos = willQoS;
+  opts.willRetain = willRetain;
+  opts.cleanSession = cleanSession;
+  opts.keepAliveSec = keepAlive / 1000;
 
-  return mqttConnectedFlag;
+  phase = PHASE_CONNACK;
+  if (!sendPacket(txBuf, mqttEncodeConnect(txBuf, sizeof(txBuf), opts))) {
+    closeWith(MQTT_CONNECT_FAILED);
+  }
+}
 
+/*-------------------------------------------------------------------------
+ * Function called by the transport when the connection has closed
+ *-------------------------------------------------------------------------*/
+void mqttTransportClosed(int state) {
+  if (phase == PHASE_IDLE) return;          // we closed it ourselves
+  if (phase == PHASE_TCP) brokerFailed();   // nothing answered there
+  if (phase != PHASE_CONNECTED) state = MQTT_CONNECT_FAILED;
+  phase = PHASE_IDLE;
+  lastState = state;
+  if (disconnectFn) disconnectFn(state);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to handle one complete packet from the broker
+ *-------------------------------------------------------------------------*/
+static void handlePacket(uint8_t header, const uint8_t *body, size_t len) {
+  switch (header & 0xF0) {
+    case MQTT_CONNACK: {
+      if (phase != PHASE_CONNACK || len < 2) return;
+      if (body[1] != 0) {                   // connection refused
+        lastState = body[1];
+        Serial.print("...ERROR: MQTT connect refused - ");
+        mqttState();
+        closeWith(body[1]);
+        return;
+      }
+      phase = PHASE_CONNECTED;
+      lastState = MQTT_CONNECTED;
+      histRecordSince(HIST_MQTT_CONNECT, connectMicros);
+      // a durable session keeps the subscriptions from the last wake
+      sessionPresent = !cleanSession && (body[0] & 0x01);
+      Serial.printf("...MQTT broker connected - %s session...\r\n",
+                    sessionPresent ? "resumed" : "new");
+      // anything still unacknowledged from the last connection goes again
+      inflightResend();
+      if (connectFn) connectFn(sessionPresent);
+      return;
+    }
+    case MQTT_PUBLISH: {
+      if (phase != PHASE_CONNECTED || len < 2) return;
+      uint8_t qos = (header >> 1) & 0x03;
+      size_t topicLen = (body[0] << 8) | body[1];
+      size_t pos = 2 + topicLen;
+      if (qos) pos += 2;
+      if (pos > len || topicLen >= sizeof(rcvTopic)) return;
+      char topic[sizeof(rcvTopic)];
+      memcpy(topic, body + 2, topicLen);
+      topic[topicLen] = '\0';
+      // act on the message before the PUBACK goes out - relay commands
+      // are switched from here
+      if (messageFn) messageFn(topic, (byte *)body + pos, len - pos);
+      if (qos == QOS_1) {
+        uint16_t id = (body[2 + topicLen] << 8) | body[3 + topicLen];
+        uint8_t ack[4];
+        sendPacket(ack, mqttEncodeAck(ack, sizeof(ack), MQTT_PUBACK, id));
+      }
+      return;
+    }
+    case MQTT_PUBACK: {
+      if (len < 2) return;
+      uint16_t id = (body[0] << 8) | body[1];
+      inflightAck(id);
+      if (publishFn) publishFn(id);
+      return;
+    }
+    case MQTT_SUBACK:
+      if (len >= 3 && body[2] == 0x80) {
+        Serial.println("ERROR: MQTT subscribe refused");
+      }
+      return;
+    case MQTT_PINGRESP:
+      pingOutstanding = false;
+      return;
+    default:
+      return;
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function called by the transport with received bytes
+ *-------------------------------------------------------------------------*/
+void mqttTransportData(const uint8_t *data, size_t len) {
+  rxMicros = micros();
+  lastIn = millis();
+  if (!mqttDecode(decoder, data, len, handlePacket)) {
+    Serial.println("ERROR: malformed MQTT packet length - closing");
+    closeWith(MQTT_CONNECTION_LOST);
+  }
 }
 
 /*-------------------------------------------------------------------------
  * Function to handle messages received from subscribed MQTT topics.
  *-------------------------------------------------------------------------*/
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  strncpy(rcvTopic, topic, sizeof(rcvTopic)); // save the topic
+  strlcpy(rcvTopic, topic, sizeof(rcvTopic)); // save the topic
   Serial.print("Message arrived [");
   Serial.print(topic);
   Serial.print("] ");
-  // print the payload and save to rcvMsg
+  // print the payload and save to rcvMsg - truncate if it will not fit
+  if (length > sizeof(rcvMsg) - 1) length = sizeof(rcvMsg) - 1;
   unsigned int i = 0;
   for (i = 0; i < length; i++) {
     Serial.print((char)payload[i]);
@@ -72,27 +251,179 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
 }
 
 /*-------------------------------------------------------------------------
- * Function to initialize the topic char arrays for this device
+ * Function to initialize the topic paths for this device
+ * - builds every entry of topicTable into topicArena exactly once
+ * - topicPreamble and the suffixes are checked against TOPIC_SIZE at
+ *   compile time, only the hostname length is checked here
  *-------------------------------------------------------------------------*/
 void mqttTopicInit() {
-  char temp[30];
+  static bool topicsBuilt = false;
+  if (topicsBuilt) return;      // the hostname never changes after WiFi_Init()
+
+  size_t hostLen = strnlen(status.host, sizeof(status.host));
+  if (hostLen > HOST_NAME_LEN) {
+    Serial.printf("WARNING: host '%s' truncated to %i characters\r\n",
+                  status.host, HOST_NAME_LEN);
+    hostLen = HOST_NAME_LEN;
+  }
+
+  for (int i = 0; i < TOPIC_COUNT; i++) {
+    char *p = topicArena[i];
+    memcpy(p, topicPreamble, sizeof(topicPreamble) - 1);
+    p += sizeof(topicPreamble) - 1;
+    memcpy(p, status.host, hostLen);
+    p += hostLen;
+    memcpy(p, topicTable[i].suffix, topicTable[i].len);
+    p += topicTable[i].len;
+    *p = '\0';
+  }
+  topicsBuilt = true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return the topic path for a topic table entry
+ *-------------------------------------------------------------------------*/
+const char *mqttTopic(TopicId id) {
+  return topicArena[id];
+}
+
+/*-------------------------------------------------------------------------
+ * Function to service the MQTT connection
+ * - connect and ping timeouts, keep alive and QoS 1 resends, returns
+ *   true while the session is established
+ *-------------------------------------------------------------------------*/
+bool mqttLoop() {
+  if (transport->poll) transport->poll();
 
-  // First create the initial topic path with topicPreamble + device name
-  strncpy(temp, topicPreamble, sizeof(temp));
-  strncat(temp, status.host, sizeof(temp));
+  unsigned long now = millis();
+  if (phase == PHASE_TCP || phase == PHASE_CONNACK) {
+    if (now - phaseStart > timeout) {
+      Serial.println("...ERROR: MQTT connect timed out...");
+      if (phase == PHASE_TCP) brokerFailed();
+      closeWith(MQTT_CONNECTION_TIMEOUT);
+    }
+    return false;
+  }
+  if (phase != PHASE_CONNECTED) return false;
 
-  // Now initialize the will topic
-  strncpy(willTopic, temp, sizeof(willTopic));
-  strncat(willTopic, will, sizeof(willTopic));
+  if (pingOutstanding) {
+    if (now - pingSent > timeout) {
+      closeWith(MQTT_CONNECTION_TIMEOUT);
+      return false;
+    }
+  }
+  else if (now - lastOut > keepAlive || now - lastIn > keepAlive) {
+    uint8_t ping[2];
+    if (sendPacket(ping, mqttEncodeEmpty(ping, sizeof(ping), MQTT_PINGREQ))) {
+      pingOutstanding = true;
+      pingSent = now;
+    }
+  }
+  inflightRetry();
+  return true;
+}
 
-  // Now initialize the input topic that will be monitored
-  strncpy(inTopic, temp, sizeof(inTopic));
-  strncat(inTopic, cmd, sizeof(inTopic));
+bool mqttConnected() {
+  return phase == PHASE_CONNECTED;
+}
 
-  // Now initialize the output topic that will represent the device status
-  strncpy(outTopic, temp, sizeof(outTopic));
-  strncat(outTopic, statusTopic, sizeof(outTopic));
+bool mqttConnecting() {
+  return phase == PHASE_TCP || phase == PHASE_CONNACK;
+}
 
+/*-------------------------------------------------------------------------
+ * Function to close the session cleanly - the last will is not sent
+ *-------------------------------------------------------------------------*/
+void mqttDisconnect() {
+  if (phase == PHASE_CONNECTED) {
+    uint8_t packet[2];
+    sendPacket(packet, mqttEncodeEmpty(packet, sizeof(packet), MQTT_DISCONNECT));
+  }
+  closeWith(MQTT_DISCONNECTED);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to publish a message at QoS 0 or QoS 1
+ * - QoS 1 messages are pipelined through the in-flight window
+ * - returns false without waiting if the window or the transport's send
+ *   buffer is full
+ *-------------------------------------------------------------------------*/
+bool mqttPublish(const char* topic, const char* msg, uint8_t qos, bool retain) {
+  if (phase != PHASE_CONNECTED) return false;
+  uint32_t start = micros();
+  bool sent;
+  if (qos != QOS_0) {
+    sent = inflightPublish(topic, msg, retain) != 0;
+  }
+  else {
+    size_t n = mqttEncodePublish(txBuf, sizeof(txBuf), topic, (const uint8_t *)msg,
+                                 strlen(msg), QOS_0, retain, false, 0);
+    sent = n && sendPacket(txBuf, n) == n;
+  }
+  histRecordSince(HIST_MQTT_PUBLISH, start);
+  return sent;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to subscribe to a topic - the SUBACK is checked when it arrives
+ *-------------------------------------------------------------------------*/
+bool mqttSubscribe(const char* topic, uint8_t qos) {
+  if (phase != PHASE_CONNECTED) return false;
+  nextSubscribeId = (nextSubscribeId % (MQTT_PACKET_ID_BASE - 1)) + 1;
+  size_t n = mqttEncodeSubscribe(txBuf, sizeof(txBuf), nextSubscribeId, topic, qos);
+  return n && sendPacket(txBuf, n) == n;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to wait until every QoS 1 message has been acknowledged
+ * - returns false if the window is not empty after timeoutMs
+ *-------------------------------------------------------------------------*/
+bool mqttDrain(unsigned long timeoutMs) {
+  unsigned long start = millis();
+  while (inflightCount()) {
+    if (!mqttLoop() || millis() - start > timeoutMs) return false;
+    delay(1);                   // lets the network stack deliver PUBACKs
+  }
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to wait for a connect under way to finish
+ * - for deep sleep wakes, which have nothing else to do meanwhile
+ *-------------------------------------------------------------------------*/
+bool mqttWaitConnected(unsigned long timeoutMs) {
+  unsigned long start = millis();
+  while (mqttConnecting() && millis() - start < timeoutMs) {
+    mqttLoop();
+    delay(10);
+  }
+  return mqttConnected();
+}
+
+/*-------------------------------------------------------------------------
+ * Functions to set the event callbacks
+ *-------------------------------------------------------------------------*/
+void mqttOnConnect(void (*fn)(bool sessionPresent)) {
+  connectFn = fn;
+}
+
+void mqttOnDisconnect(void (*fn)(int state)) {
+  disconnectFn = fn;
+}
+
+void mqttOnMessage(void (*fn)(char* topic, byte* payload, unsigned int length)) {
+  messageFn = fn;
+}
+
+void mqttOnPublish(void (*fn)(uint16_t packetId)) {
+  publishFn = fn;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return micros() when the message being handled arrived
+ *-------------------------------------------------------------------------*/
+uint32_t mqttRxMicros() {
+  return rxMicros;
 }
 
 /*-------------------------------------------------------------------------
@@ -100,7 +431,7 @@ void mqttTopicInit() {
  *-------------------------------------------------------------------------*/
 int mqttState() {
   // now report why it failed
-  int state = mqttClient.state();
+  int state = lastState;
 
   switch (state) {
     case MQTT_CONNECTED : {
@@ -3,32 +3,27 @@
 
 #include <Arduino.h>        // required for VSC & PlatformIO
 #include <ESP8266WiFi.h>    // for NodeMCU and ESP8266 ethernet modules
-#include <ESP8266WiFiMulti.h>
-#include <PubSubClient.h>   //for mqtt
 #include "WiFi_Init.h"      // needed for status struct
+#include "topics.h"         // MQTT topic table
+#include "mqtt_codec.h"     // MQTT packet encoder and decoder
+#include "mqtt_transport.h" // connection under the MQTT client
+#include "inflight.h"       // QoS 1 in-flight window
+#include "histogram.h"      // connect and publish times
+#include "broker.h"         // broker address cache
 #include <stdlib.h>
 
-
-WiFiClient wifiClient;
-PubSubClient mqttClient(wifiClient);    // create a PubSubClient object
-
 //++++++++++++++++++++++
 // MQTT function globals
-#define STATUS_INTERVAL 30000UL   // online message interval
-// MQTT topic definitions
-#define QOS_0 0
-#define QOS_1 1
-#define QOS_2 2
-const char topicPreamble[] = "MyIoT/";
-const char will[] = "/will";
 int willQoS = 1;                  // use QoS = 1 for last will message
 bool willRetain = true;           // retain the last will
 bool cleanSession = true;         // true = start fresh; false = durable
-const char cmd[] = "/cmd";
-const char statusTopic[] = "/status";
-char willTopic[40] = "/ESP_xxxxxx/will";
-char inTopic[40]   = "/ESP_xxxxxx/cmd";
-char outTopic[40] = "/ESP_xxxxxx/status";
+bool sessionPresent = false;      // broker kept the session from the last wake
+
+// topic paths are assembled once into topicArena by mqttTopicInit()
+char topicArena[TOPIC_COUNT][TOPIC_SIZE];
+extern char * const willTopic = topicArena[TOPIC_WILL];
+extern char * const inTopic = topicArena[TOPIC_CMD];
+extern char * const outTopic = topicArena[TOPIC_STATUS];
 char willMessage[128] = "Offline";
 char outMsg[128] = "Online";
 char rcvMsg[256] = "";  //message receive buffer
@@ -40,10 +35,23 @@ const unsigned long keepAlive = 15 * 1000UL;
 const unsigned long timeout = 15 * 1000UL;
 
 // Forward function definitions
-bool connectMqtt();
+bool connectMqtt(bool lookup);
 void mqttTopicInit();
 void mqttCallback(char* topic, byte* payload, unsigned int length);
 int mqttState();
-void publish(char* topic, char* msg);
+bool mqttConnected();
+bool mqttConnecting();
+void mqttDisconnect();
+bool mqttLoop();
+bool mqttPublish(const char* topic, const char* msg, uint8_t qos, bool retain);
+bool mqttSubscribe(const char* topic, uint8_t qos);
+bool mqttDrain(unsigned long timeoutMs);
+bool mqttWaitConnected(unsigned long timeoutMs);
+void mqttOnConnect(void (*fn)(bool sessionPresent));
+void mqttOnDisconnect(void (*fn)(int state));
+void mqttOnMessage(void (*fn)(char* topic, byte* payload, unsigned int length));
+void mqttOnPublish(void (*fn)(uint16_t packetId));
+uint32_t mqttRxMicros();
+void publish(const char* topic, const char* msg);
 
 #endif  // __MQTT_H__
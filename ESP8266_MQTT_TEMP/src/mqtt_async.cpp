@@ -0,0 +1,49 @@
+#include <ESPAsyncTCP.h>
+#include "mqtt_transport.h"
+
+/*-------------------------------------------------------------------------
+ * Plain TCP transport on ESPAsyncTCP
+ * - the callbacks run from the network stack between passes of loop(),
+ *   nothing here waits for the network
+ *-------------------------------------------------------------------------*/
+static AsyncClient asyncClient;
+static bool handlersSet = false;
+
+static bool asyncOpen(const char *host, const IPAddress &ip, uint16_t port) {
+  if (!handlersSet) {
+    asyncClient.onConnect([](void *, AsyncClient *client) {
+      client->setNoDelay(true);   // small MQTT packets, no Nagle delay
+      mqttTransportConnected();
+    });
+    asyncClient.onData([](void *, AsyncClient *, void *data, size_t len) {
+      mqttTransportData((const uint8_t *)data, len);
+    });
+    asyncClient.onError([](void *, AsyncClient *, int8_t error) {
+      Serial.printf("MQTT TCP error: %s\r\n", AsyncClient::errorToString(error));
+    });
+    asyncClient.onDisconnect([](void *, AsyncClient *) {
+      mqttTransportClosed(MQTT_CONNECTION_LOST);
+    });
+    handlersSet = true;
+  }
+  return asyncClient.connect(ip, port);
+}
+
+static size_t asyncSpace() {
+  return asyncClient.connected() ? asyncClient.space() : 0;
+}
+
+static size_t asyncWrite(const uint8_t *buf, size_t len) {
+  if (asyncSpace() < len) return 0;
+  size_t n = asyncClient.add((const char *)buf, len);
+  asyncClient.send();
+  return n;
+}
+
+static void asyncClose() {
+  asyncClient.close(true);
+}
+
+const MqttTransport asyncTransport = {
+  "tcp", asyncOpen, asyncSpace, asyncWrite, nullptr, asyncClose
+};
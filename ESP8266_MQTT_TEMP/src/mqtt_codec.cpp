@@ -0,0 +1,210 @@
+#include "mqtt_codec.h"
+
+/*-------------------------------------------------------------------------
+ * Packet writer - every put is bounds checked, a packet that does not
+ * fit leaves ok false and is not sent
+ *-------------------------------------------------------------------------*/
+struct PacketWriter {
+  uint8_t *buf;
+  size_t size;
+  size_t n;
+  bool ok;
+};
+
+static void put(PacketWriter &w, const void *data, size_t len) {
+  if (w.n + len > w.size) {
+    w.ok = false;
+    return;
+  }
+  memcpy(w.buf + w.n, data, len);
+  w.n += len;
+}
+
+static void put8(PacketWriter &w, uint8_t b) {
+  put(w, &b, 1);
+}
+
+static void put16(PacketWriter &w, uint16_t v) {
+  put8(w, v >> 8);
+  put8(w, v & 0xFF);
+}
+
+static void putString(PacketWriter &w, const char *s) {
+  size_t len = strlen(s);
+  put16(w, len);
+  put(w, s, len);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to start a packet - the fixed header is written once the body
+ * length is known so the body starts after the longest length varint
+ *-------------------------------------------------------------------------*/
+static PacketWriter begin(uint8_t *buf, size_t size) {
+  PacketWriter w = { buf, size, 5, size >= 5 };
+  return w;
+}
+
+static size_t finish(PacketWriter &w, uint8_t header) {
+  if (!w.ok) return 0;
+  uint32_t remaining = w.n - 5;
+  uint8_t len[4];
+  size_t lenBytes = 0;
+  do {
+    uint8_t b = remaining & 0x7F;
+    remaining >>= 7;
+    len[lenBytes++] = remaining ? b | 0x80 : b;
+  } while (remaining);
+
+  // move the fixed header down against the body
+  size_t start = 5 - 1 - lenBytes;
+  w.buf[start] = header;
+  memcpy(w.buf + start + 1, len, lenBytes);
+  size_t total = w.n - start;
+  memmove(w.buf, w.buf + start, total);
+  return total;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to build a CONNECT packet
+ *-------------------------------------------------------------------------*/
+size_t mqttEncodeConnect(uint8_t *buf, size_t size, const MqttConnectOpts &opts) {
+  bool hasUser = opts.user && opts.user[0];
+  bool hasPassword = hasUser && opts.password && opts.password[0];
+  uint8_t flags = opts.cleanSession ? 0x02 : 0;
+  if (opts.willTopic) {
+    flags |= 0x04 | (opts.willQos & 0x03) << 3 | (opts.willRetain ? 0x20 : 0);
+  }
+  if (hasUser) flags |= 0x80;
+  if (hasPassword) flags |= 0x40;
+
+  PacketWriter w = begin(buf, size);
+  putString(w, "MQTT");
+  put8(w, 4);                     // protocol level 3.1.1
+  put8(w, flags);
+  put16(w, opts.keepAliveSec);
+  putString(w, opts.clientId);
+  if (opts.willTopic) {
+    putString(w, opts.willTopic);
+    putString(w, opts.willMessage);
+  }
+  if (hasUser) putString(w, opts.user);
+  if (hasPassword) putString(w, opts.password);
+  return finish(w, MQTT_CONNECT);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to build a PUBLISH packet - packetId is ignored at QoS 0
+ *-------------------------------------------------------------------------*/
+size_t mqttEncodePublish(uint8_t *buf, size_t size, const char *topic,
+                         const uint8_t *payload, size_t len, uint8_t qos,
+                         bool retain, bool dup, uint16_t packetId) {
+  PacketWriter w = begin(buf, size);
+  putString(w, topic);
+  if (qos) put16(w, packetId);
+  put(w, payload, len);
+  uint8_t header = MQTT_PUBLISH | (dup ? 0x08 : 0) | (qos & 0x03) << 1 |
+                   (retain ? 0x01 : 0);
+  return finish(w, header);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to build a SUBSCRIBE packet for a single topic
+ *-------------------------------------------------------------------------*/
+size_t mqttEncodeSubscribe(uint8_t *buf, size_t size, uint16_t packetId,
+                           const char *topic, uint8_t qos) {
+  PacketWriter w = begin(buf, size);
+  put16(w, packetId);
+  putString(w, topic);
+  put8(w, qos);
+  return finish(w, MQTT_SUBSCRIBE);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to build an acknowledgement carrying only a packet id
+ *-------------------------------------------------------------------------*/
+size_t mqttEncodeAck(uint8_t *buf, size_t size, uint8_t type, uint16_t packetId) {
+  if (size < 4) return 0;
+  buf[0] = type;
+  buf[1] = 2;
+  buf[2] = packetId >> 8;
+  buf[3] = packetId & 0xFF;
+  return 4;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to build a packet without a body - PINGREQ, DISCONNECT
+ *-------------------------------------------------------------------------*/
+size_t mqttEncodeEmpty(uint8_t *buf, size_t size, uint8_t type) {
+  if (size < 2) return 0;
+  buf[0] = type;
+  buf[1] = 0;
+  return 2;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to reset the decoder at the start of a connection
+ *-------------------------------------------------------------------------*/
+void mqttDecoderReset(MqttDecoder &d) {
+  d.state = 0;
+  d.fill = 0;
+  d.overflow = false;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to frame received bytes into packets
+ * - fn is called for each complete packet that fits in MQTT_RX_MAX,
+ *   larger packets are read and dropped
+ * - returns false on a remaining length longer than MQTT_LENGTH_BYTES,
+ *   the stream cannot be framed any more and the decoder is reset
+ *-------------------------------------------------------------------------*/
+bool mqttDecode(MqttDecoder &d, const uint8_t *data, size_t len, MqttPacketHandler fn) {
+  while (len) {
+    switch (d.state) {
+      case 0:                     // fixed header byte
+        d.header = *data++;
+        len--;
+        d.remaining = 0;
+        d.shift = 0;
+        d.fill = 0;
+        d.overflow = false;
+        d.state = 1;
+        continue;
+      case 1: {                   // remaining length varint
+        uint8_t b = *data++;
+        len--;
+        d.remaining |= (uint32_t)(b & 0x7F) << d.shift;
+        d.shift += 7;
+        if ((b & 0x80) && d.shift >= 7 * MQTT_LENGTH_BYTES) {
+          mqttDecoderReset(d);
+          return false;
+        }
+        if (b & 0x80) continue;
+        d.overflow = d.remaining > sizeof(d.buf);
+        if (d.remaining) {
+          d.state = 2;
+          continue;
+        }
+        break;
+      }
+      default: {                  // body - copied in runs
+        size_t n = len < d.remaining ? len : d.remaining;
+        if (!d.overflow) memcpy(d.buf + d.fill, data, n);
+        d.fill += n;
+        data += n;
+        len -= n;
+        d.remaining -= n;
+        if (d.remaining) continue;
+        break;
+      }
+    }
+
+    // a complete packet has been read
+    d.state = 0;
+    if (d.overflow) {
+      Serial.printf("WARNING: %u byte MQTT packet dropped\r\n", (unsigned)d.fill);
+      continue;
+    }
+    fn(d.header, d.buf, d.fill);
+  }
+  return true;
+}
@@ -0,0 +1,63 @@
+#ifndef __MQTT_CODEC_H__
+#define __MQTT_CODEC_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// MQTT 3.1.1 packet encoder and streaming decoder
+// Transport agnostic - packets are built into caller buffers and the
+// received bytes are framed whatever size pieces they arrive in.
+#define MQTT_RX_MAX 512           // largest packet the decoder keeps
+#define MQTT_TX_MAX 512           // largest packet the client builds
+#define MQTT_LENGTH_BYTES 4       // remaining length varint limit, 3.1.1
+
+// control packet types - the high nibble of the fixed header
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     0x20
+#define MQTT_PUBLISH     0x30
+#define MQTT_PUBACK      0x40
+#define MQTT_SUBSCRIBE   0x82     // includes the required flag bits
+#define MQTT_SUBACK      0x90
+#define MQTT_PINGREQ     0xC0
+#define MQTT_PINGRESP    0xD0
+#define MQTT_DISCONNECT  0xE0
+
+struct MqttConnectOpts {
+  const char *clientId;
+  const char *user;               // nullptr or "" = none
+  const char *password;
+  const char *willTopic;          // nullptr = no last will
+  const char *willMessage;
+  uint8_t willQos;
+  bool willRetain;
+  bool cleanSession;
+  uint16_t keepAliveSec;
+};
+
+struct MqttDecoder {
+  uint8_t state;                  // 0 = fixed header, 1 = length, 2 = body
+  uint8_t header;                 // fixed header byte of the current packet
+  uint8_t shift;                  // remaining length varint position
+  uint32_t remaining;             // body bytes still to come
+  size_t fill;                    // body bytes kept in buf
+  bool overflow;                  // packet larger than MQTT_RX_MAX - skipped
+  uint8_t buf[MQTT_RX_MAX];
+};
+
+// called with each complete packet - body excludes the fixed header
+typedef void (*MqttPacketHandler)(uint8_t header, const uint8_t *body, size_t len);
+
+//++++++++++++++++++++++
+// Forward function declarations
+size_t mqttEncodeConnect(uint8_t *buf, size_t size, const MqttConnectOpts &opts);
+size_t mqttEncodePublish(uint8_t *buf, size_t size, const char *topic,
+                         const uint8_t *payload, size_t len, uint8_t qos,
+                         bool retain, bool dup, uint16_t packetId);
+size_t mqttEncodeSubscribe(uint8_t *buf, size_t size, uint16_t packetId,
+                           const char *topic, uint8_t qos);
+size_t mqttEncodeAck(uint8_t *buf, size_t size, uint8_t type, uint16_t packetId);
+size_t mqttEncodeEmpty(uint8_t *buf, size_t size, uint8_t type);
+void mqttDecoderReset(MqttDecoder &d);
+bool mqttDecode(MqttDecoder &d, const uint8_t *data, size_t len, MqttPacketHandler fn);
+
+#endif  // __MQTT_CODEC_H__
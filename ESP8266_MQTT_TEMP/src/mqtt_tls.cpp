@@ -0,0 +1,202 @@
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecureBearSSL.h>
+#include <coredecls.h>          // crc32()
+#include "mqtt_transport.h"
+#include "WiFi_Init.h"
+#include "rtcmem.h"
+#include "history.h"
+#include "governor.h"
+
+extern Config config;  // declare the external configuration struct
+
+TlsStats tlsStats;     // instantiate the TLS handshake statistics
+
+//++++++++++++++++++++++
+// TLS session cache in RTC memory
+// The BearSSL session (id, cipher suite and master secret) is kept across
+// deep sleep so a wake resumes the session with an abbreviated handshake
+// instead of a full RSA/ECDHE one.  The MFLN probe result is cached with
+// it so the probe connection is only made once per broker.
+#define TLS_RTC_MAGIC 0x544C5331      // "TLS1"
+#define TLS_MFLN_UNKNOWN 0
+#define TLS_MFLN_YES 1
+#define TLS_MFLN_NO 2
+
+struct TlsRtc {
+  uint32_t magic;
+  uint32_t crc;                     // crc32 of everything after this field
+  uint32_t hostHash;                // broker the session belongs to
+  uint16_t port;
+  uint8_t mfln;                     // TLS_MFLN_*
+  uint8_t reserved;
+  uint8_t session[sizeof(BearSSL::Session)];
+};
+
+static_assert(RTC_TLS + RTC_BLOCKS(TlsRtc) <= RTC_TLS_END,
+              "TlsRtc does not fit its RTC memory slot");
+// the session is saved as raw bytes - it must be just the parameters
+static_assert(sizeof(BearSSL::Session) == sizeof(br_ssl_session_parameters),
+              "BearSSL::Session layout changed");
+
+static BearSSL::WiFiClientSecure tlsClient;
+static BearSSL::Session tlsSession;
+static TlsRtc tlsRtc;
+static bool tlsOpen = false;
+#ifdef MQTT_CA_CERT
+static BearSSL::X509List tlsTrust(MQTT_CA_CERT);
+#endif
+
+/*-------------------------------------------------------------------------
+ * Function to hash the broker name - a cached session is only offered to
+ * the broker it was made with
+ *-------------------------------------------------------------------------*/
+static uint32_t hostHash(const char *host, uint16_t port) {
+  return crc32(host, strlen(host), port);
+}
+
+static uint32_t tlsRtcCrc() {
+  const uint8_t *p = (const uint8_t *)&tlsRtc.hostHash;
+  return crc32(p, sizeof(tlsRtc) - offsetof(TlsRtc, hostHash));
+}
+
+static void tlsRtcSave() {
+  tlsRtc.magic = TLS_RTC_MAGIC;
+  memcpy(tlsRtc.session, &tlsSession, sizeof(tlsRtc.session));
+  tlsRtc.crc = tlsRtcCrc();
+  ESP.rtcUserMemoryWrite(RTC_TLS, (uint32_t *)&tlsRtc, sizeof(tlsRtc));
+}
+
+/*-------------------------------------------------------------------------
+ * Function to load the cached session for this broker from RTC memory
+ * - a bad CRC or a different broker starts with an empty session
+ *-------------------------------------------------------------------------*/
+static void tlsRtcLoad(const char *host, uint16_t port) {
+  static bool loaded = false;
+  if (loaded) return;           // the RAM copy is current after the first load
+  loaded = true;
+
+  ESP.rtcUserMemoryRead(RTC_TLS, (uint32_t *)&tlsRtc, sizeof(tlsRtc));
+  uint32_t hash = hostHash(host, port);
+  if (tlsRtc.magic != TLS_RTC_MAGIC || tlsRtc.crc != tlsRtcCrc() ||
+      tlsRtc.hostHash != hash || tlsRtc.port != port) {
+    memset(&tlsRtc, 0, sizeof(tlsRtc));
+    tlsRtc.hostHash = hash;
+    tlsRtc.port = port;
+    return;
+  }
+  memcpy(&tlsSession, tlsRtc.session, sizeof(tlsRtc.session));
+  Serial.println("...TLS session loaded from RTC memory...");
+}
+
+/*-------------------------------------------------------------------------
+ * Function to open the TLS connection
+ * - the handshake itself blocks, with a resumed session it is one round
+ *   trip and a few ms of CPU, a full handshake takes seconds at 80 MHz
+ *-------------------------------------------------------------------------*/
+static bool tlsConnect(const char *host, const IPAddress &ip, uint16_t port) {
+  // a CA certificate checks the broker name, that needs the connect by
+  // name - otherwise the resolved address saves the lookup
+#ifdef MQTT_CA_CERT
+  bool byName = host[0] != '\0';
+#else
+  bool byName = false;
+#endif
+  String ipName = ip.toString();
+  tlsRtcLoad(host[0] ? host : ipName.c_str(), port);
+
+  // trust - a CA certificate, else a fingerprint, else none at all
+#ifdef MQTT_CA_CERT
+  tlsClient.setTrustAnchors(&tlsTrust);
+  uint32_t now = historyNow();
+  if (now) tlsClient.setX509Time(now);
+#else
+  if (config.mqttFingerprint[0]) {
+    tlsClient.setFingerprint(config.mqttFingerprint);
+  }
+  else {
+    Serial.println("WARNING: MQTT TLS without broker verification");
+    tlsClient.setInsecure();
+  }
+#endif
+
+  // MFLN shrinks the receive buffer from 16 KB when the broker allows it
+  if (tlsRtc.mfln == TLS_MFLN_UNKNOWN) {
+    bool mfln = byName ? tlsClient.probeMaxFragmentLength(host, port, MQTT_TLS_MFLN)
+                       : tlsClient.probeMaxFragmentLength(ip, port, MQTT_TLS_MFLN);
+    tlsRtc.mfln = mfln ? TLS_MFLN_YES : TLS_MFLN_NO;
+    Serial.printf("...TLS max fragment length %s...\r\n",
+                  mfln ? "supported" : "not supported");
+  }
+  if (tlsRtc.mfln == TLS_MFLN_YES) {
+    tlsClient.setBufferSizes(MQTT_TLS_MFLN, MQTT_TLS_TX_BUFFER);
+  }
+  else {
+    tlsClient.setBufferSizes(16384, MQTT_TLS_TX_BUFFER);
+  }
+
+  br_ssl_session_parameters before = *(br_ssl_session_parameters *)&tlsSession;
+  tlsClient.setSession(&tlsSession);
+  unsigned long start = millis();
+  governorBoost(CPU_HINT_TLS);      // the handshake is all big number math
+  bool connected = byName ? tlsClient.connect(host, port) : tlsClient.connect(ip, port);
+  governorRelease(CPU_HINT_TLS);
+  if (!connected) {
+    char err[64];
+    int code = tlsClient.getLastSSLError(err, sizeof(err));
+    Serial.printf("MQTT TLS error %i: %s\r\n", code, err);
+    memset(&tlsSession, 0, sizeof(tlsSession));   // do not offer it again
+    tlsRtcSave();
+    return false;
+  }
+
+  // the same session id after the handshake means it was resumed
+  br_ssl_session_parameters *after = (br_ssl_session_parameters *)&tlsSession;
+  bool resumed = before.session_id_len &&
+                 before.session_id_len == after->session_id_len &&
+                 memcmp(before.session_id, after->session_id, before.session_id_len) == 0;
+  tlsStats.lastMs = millis() - start;
+  tlsStats.handshakes++;
+  if (resumed) tlsStats.resumed++;
+  Serial.printf("...TLS %s handshake in %lu ms...\r\n",
+                resumed ? "resumed" : "full", (unsigned long)tlsStats.lastMs);
+  tlsRtcSave();
+
+  tlsOpen = true;
+  mqttTransportConnected();
+  return true;
+}
+
+static size_t tlsSpace() {
+  return tlsOpen ? tlsClient.availableForWrite() : 0;
+}
+
+static size_t tlsWrite(const uint8_t *buf, size_t len) {
+  return tlsOpen ? tlsClient.write(buf, len) : 0;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to pass received bytes on - called from mqttLoop()
+ *-------------------------------------------------------------------------*/
+static void tlsPoll() {
+  if (!tlsOpen) return;
+  uint8_t buf[128];
+  int avail;
+  while ((avail = tlsClient.available()) > 0) {
+    int n = tlsClient.read(buf, avail < (int)sizeof(buf) ? avail : sizeof(buf));
+    if (n <= 0) break;
+    mqttTransportData(buf, n);
+  }
+  if (tlsOpen && !tlsClient.connected()) {
+    tlsOpen = false;
+    mqttTransportClosed(MQTT_CONNECTION_LOST);
+  }
+}
+
+static void tlsClose() {
+  tlsOpen = false;
+  tlsClient.stop();
+}
+
+const MqttTransport tlsTransport = {
+  "tls", tlsConnect, tlsSpace, tlsWrite, tlsPoll, tlsClose
+};
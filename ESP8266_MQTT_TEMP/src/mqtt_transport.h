@@ -0,0 +1,58 @@
+#ifndef __MQTT_TRANSPORT_H__
+#define __MQTT_TRANSPORT_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// MQTT client states - numbered like PubSubClient's, the positive values
+// are the CONNACK return codes
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+#define MQTT_CONNECT_BAD_PROTOCOL    1
+#define MQTT_CONNECT_BAD_CLIENT_ID   2
+#define MQTT_CONNECT_UNAVAILABLE     3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED    5
+
+//++++++++++++++++++++++
+// Byte transport under the MQTT client
+// A transport opens the connection and moves bytes, it reports back
+// through the mqttTransport* event functions implemented in mqtt.cpp.
+// Event driven transports call them from their own callbacks, polled
+// transports from poll(), which the client calls from mqttLoop().
+struct MqttTransport {
+  const char *name;
+  // start connecting to ip, host names the broker for TLS
+  bool (*open)(const char *host, const IPAddress &ip, uint16_t port);
+  size_t (*space)();                              // bytes write() accepts now
+  size_t (*write)(const uint8_t *buf, size_t len);
+  void (*poll)();                                 // nullptr if event driven
+  void (*close)();
+};
+
+extern const MqttTransport asyncTransport;  // plain TCP on ESPAsyncTCP
+extern const MqttTransport tlsTransport;    // BearSSL, polled
+
+//++++++++++++++++++++++
+// TLS settings and handshake statistics
+#define MQTT_TLS_MFLN 1024        // max fragment length asked of the broker
+#define MQTT_TLS_TX_BUFFER 512    // BearSSL send buffer
+
+struct TlsStats {
+  uint32_t handshakes;            // TLS connects made
+  uint32_t resumed;               // of those, resumed from the cached session
+  uint32_t lastMs;                // duration of the last handshake
+};
+
+extern TlsStats tlsStats;
+
+//++++++++++++++++++++++
+// Transport events
+void mqttTransportConnected();
+void mqttTransportData(const uint8_t *data, size_t len);
+void mqttTransportClosed(int state);
+
+#endif  // __MQTT_TRANSPORT_H__
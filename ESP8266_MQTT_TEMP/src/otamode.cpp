@@ -0,0 +1,164 @@
+#include <ESP8266WiFi.h>
+#include <Updater.h>
+#include "otamode.h"
+#include "rtcmem.h"
+#include "governor.h"
+
+#define OTA_REPORT_MAGIC 0x4F544131   // "OTA1"
+
+static_assert(RTC_OTA_REPORT + RTC_BLOCKS(OtaReport) <= RTC_OTA_REPORT_END,
+              "OtaReport does not fit its RTC memory slot");
+
+extern bool mqttConnected();
+extern void mqttDisconnect();
+
+static bool active = false;
+static OtaSource activeSource;
+static unsigned long startMs = 0;
+static size_t received = 0;
+static unsigned long progressMs = 0;  // last time the image grew
+static WiFiSleepType_t savedSleep = WIFI_NONE_SLEEP;
+static bool restartPending = false;
+static unsigned long restartAt = 0;
+static OtaReport report;              // transfer in progress
+static OtaReport lastReport;          // report from before the restart
+static bool reportPending = false;
+
+// first 32 bits of the running sketch's MD5 - changes with the sketch
+static uint32_t sketchMd5Prefix() {
+  char hex[9];
+  strlcpy(hex, ESP.getSketchMD5().c_str(), sizeof(hex));
+  return strtoul(hex, NULL, 16);
+}
+
+static void reportSave() {
+  report.ms = millis() - startMs;
+  report.bytes = received;
+  ESP.rtcUserMemoryWrite(RTC_OTA_REPORT, (uint32_t *)&report, sizeof(report));
+}
+
+/*-------------------------------------------------------------------------
+ * Function to pick up the report of an update made before this boot
+ *-------------------------------------------------------------------------*/
+void otaModeInit() {
+  ESP.rtcUserMemoryRead(RTC_OTA_REPORT, (uint32_t *)&lastReport, sizeof(lastReport));
+  reportPending = lastReport.magic == OTA_REPORT_MAGIC;
+  if (reportPending) {
+    // restarted mid-report - the update took if the sketch changed
+    if (lastReport.state == OTA_STATE_RUNNING) {
+      lastReport.state = sketchMd5Prefix() != lastReport.md5Prefix ?
+                         OTA_STATE_OK : OTA_STATE_FAILED;
+    }
+    OtaReport cleared = {};
+    ESP.rtcUserMemoryWrite(RTC_OTA_REPORT, (uint32_t *)&cleared, sizeof(cleared));
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to enter update mode at the start of a transfer
+ *-------------------------------------------------------------------------*/
+void otaModeBegin(OtaSource source) {
+  if (active) return;
+  active = true;
+  activeSource = source;
+  startMs = millis();
+  progressMs = startMs;
+  received = 0;
+
+  if (mqttConnected()) mqttDisconnect();    // heap and airtime for the image
+  governorBoost(CPU_HINT_OTA);
+  savedSleep = WiFi.getSleepMode();
+  WiFi.setSleepMode(WIFI_NONE_SLEEP);       // no modem sleep between packets
+
+  memset(&report, 0, sizeof(report));
+  report.magic = OTA_REPORT_MAGIC;
+  report.md5Prefix = sketchMd5Prefix();
+  report.state = OTA_STATE_RUNNING;
+  report.source = source;
+  reportSave();
+  Serial.printf("*** OTA update started - %s ***\r\n",
+                source == OTA_SRC_ARDUINO ? "ArduinoOTA" : "web");
+}
+
+void otaModeProgress(size_t bytes) {
+  if (!active || bytes == received) return;
+  received = bytes;
+  progressMs = millis();
+  reportSave();                 // a few RTC words - cheap enough per chunk
+}
+
+/*-------------------------------------------------------------------------
+ * Function to leave update mode and record the transfer
+ * - a successful update stays in update mode until the restart, a failed
+ *   one resumes normal operation
+ *-------------------------------------------------------------------------*/
+void otaModeEnd(bool ok) {
+  if (!active) return;
+  report.state = ok ? OTA_STATE_OK : OTA_STATE_FAILED;
+  reportSave();
+  Serial.printf("*** OTA update %s - %u bytes in %u ms, %u B/s ***\r\n",
+                ok ? "done" : "FAILED", report.bytes, report.ms,
+                report.ms ? (unsigned)(1000ULL * report.bytes / report.ms) : 0);
+  if (ok) return;
+
+  // failed - back to normal operation, the report goes out on reconnect
+  lastReport = report;
+  reportPending = true;
+  OtaReport cleared = {};
+  ESP.rtcUserMemoryWrite(RTC_OTA_REPORT, (uint32_t *)&cleared, sizeof(cleared));
+  governorRelease(CPU_HINT_OTA);
+  WiFi.setSleepMode(savedSleep);
+  active = false;
+}
+
+bool otaModeActive() {
+  return active;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to follow web uploads and restart after a successful update
+ * - called every pass of loop(), ArduinoOTA uses the callbacks instead
+ *-------------------------------------------------------------------------*/
+void otaModeLoop() {
+  bool running = Update.isRunning();
+  if (running && !active) otaModeBegin(OTA_SRC_WEB);
+  if (active && activeSource == OTA_SRC_WEB) {
+    if (running) otaModeProgress(Update.progress());
+    if (running && millis() - progressMs > OTA_STALL_MS) {
+      Serial.println("*** OTA upload stalled - aborted ***");
+      Update.end(false);          // unfinished - discards the image
+      otaModeEnd(false);
+    } else if (!running) {
+      otaModeEnd(!Update.hasError());
+    }
+  }
+  if (restartPending && millis() - restartAt > OTA_RESTART_DELAY_MS) {
+    Serial.println("*** Restarting into the new firmware ***");
+    ESP.restart();
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to restart from loop() - the web handlers run in the network
+ * stack's context where ESP.restart() may not be called
+ *-------------------------------------------------------------------------*/
+void otaModeRequestRestart() {
+  restartPending = true;
+  restartAt = millis();
+}
+
+/*-------------------------------------------------------------------------
+ * Function to format the pending update report once
+ * - returns false when there is nothing to report
+ *-------------------------------------------------------------------------*/
+bool otaReportFormat(char *msg, size_t len, const char *host) {
+  if (!reportPending) return false;
+  reportPending = false;
+  snprintf(msg, len,
+           "{\"%s\":{\"ota\":{\"ok\":%u,\"src\":\"%s\",\"bytes\":%u,\"ms\":%u,\"Bps\":%u}}}",
+           host, lastReport.state == OTA_STATE_OK,
+           lastReport.source == OTA_SRC_ARDUINO ? "arduino" : "web",
+           lastReport.bytes, lastReport.ms,
+           lastReport.ms ? (unsigned)(1000ULL * lastReport.bytes / lastReport.ms) : 0);
+  return true;
+}
@@ -0,0 +1,48 @@
+#ifndef __OTAMODE_H__
+#define __OTAMODE_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// OTA update mode
+// While a firmware image is being received the node stops sampling,
+// publishing and deep sleeping, drops the MQTT connection to free heap,
+// holds the governor's CPU boost and keeps the WiFi radio awake.  ArduinoOTA
+// drives the mode from its callbacks; the web uploads (ElegantOTA's
+// /update and /update-delta) are noticed by polling Update.  The
+// transfer size, duration and result are kept in RTC memory over the
+// restart and published once the broker is connected again.  ElegantOTA
+// restarts from inside its request handler, so the report is kept up to
+// date during the transfer and a report still marked running at boot is
+// resolved by checking whether the sketch MD5 changed.  A web upload
+// whose browser goes away never finishes on its own, so one that makes
+// no progress for OTA_STALL_MS is aborted and the node resumes.
+#define OTA_RESTART_DELAY_MS 1000UL   // let the HTTP response go out first
+#define OTA_STALL_MS 30000UL          // abort a web upload without progress
+
+enum OtaSource { OTA_SRC_ARDUINO, OTA_SRC_WEB };
+
+enum OtaState { OTA_STATE_RUNNING, OTA_STATE_OK, OTA_STATE_FAILED };
+
+struct OtaReport {
+  uint32_t magic;
+  uint32_t bytes;             // image bytes received
+  uint32_t ms;                // transfer duration
+  uint32_t md5Prefix;         // first 32 bits of the old sketch MD5
+  uint8_t state;              // OtaState
+  uint8_t source;             // OtaSource
+  uint16_t reserved;
+};
+
+//++++++++++++++++++++++
+// Forward function declarations
+void otaModeInit();
+void otaModeBegin(OtaSource source);
+void otaModeProgress(size_t bytes);
+void otaModeEnd(bool ok);
+bool otaModeActive();
+void otaModeLoop();
+void otaModeRequestRestart();
+bool otaReportFormat(char *msg, size_t len, const char *host);
+
+#endif  // __OTAMODE_H__
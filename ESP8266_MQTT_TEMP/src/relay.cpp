@@ -0,0 +1,61 @@
+#include "relay.h"
+#include "histogram.h"
+
+static uint8_t relayPin;
+static bool relayState = false;         // the pin is only written here
+
+/*-------------------------------------------------------------------------
+ * Function to set up the relay output, off
+ *-------------------------------------------------------------------------*/
+void relayInit(uint8_t pin) {
+  relayPin = pin;
+  pinMode(relayPin, OUTPUT);
+  digitalWrite(relayPin, LOW);
+  relayState = false;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to act on a relay command
+ * - payload is "ON", "OFF" or "TOGGLE", optionally followed by a space
+ *   and a correlation id
+ * - rxMicros is micros() when the packet reached the transport
+ * - returns false and leaves the relay alone for anything else
+ *-------------------------------------------------------------------------*/
+bool relayCommand(const byte *payload, unsigned int length, uint32_t rxMicros,
+                  RelayAck &ack) {
+  unsigned int cmdLen = 0;
+  while (cmdLen < length && payload[cmdLen] != ' ') cmdLen++;
+  const char *cmd = (const char *)payload;
+
+  int level;
+  if (cmdLen == 2 && memcmp(cmd, "ON", 2) == 0) level = HIGH;
+  else if (cmdLen == 3 && memcmp(cmd, "OFF", 3) == 0) level = LOW;
+  else if (cmdLen == 6 && memcmp(cmd, "TOGGLE", 6) == 0) level = relayState ? LOW : HIGH;
+  else return false;
+
+  digitalWrite(relayPin, level);        // actuate first, account after
+  ack.latencyUs = micros() - rxMicros;
+  relayState = level == HIGH;
+  ack.on = relayState;
+  histRecord(HIST_RELAY, ack.latencyUs);
+
+  unsigned int idLen = 0;
+  if (cmdLen < length) {                // skip the space
+    idLen = length - cmdLen - 1;
+    if (idLen > RELAY_ID_LEN - 1) idLen = RELAY_ID_LEN - 1;
+    for (unsigned int i = 0; i < idLen; i++) {
+      char c = payload[cmdLen + 1 + i];   // the id is echoed inside JSON
+      ack.id[i] = (c == '"' || c == '\\' || c < ' ') ? '_' : c;
+    }
+  }
+  ack.id[idLen] = '\0';
+  return true;
+}
+
+bool relayOn() {
+  return relayState;
+}
+
+const char *relayStateName() {
+  return relayOn() ? "ON" : "OFF";
+}
@@ -0,0 +1,30 @@
+#ifndef __RELAY_H__
+#define __RELAY_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Relay commands
+// ON, OFF and TOGGLE on inTopic switch the relay straight from the MQTT
+// receive callback instead of waiting for loop() to come round to the
+// message.  A command may carry a correlation id after a space, e.g.
+// "ON 42", which is returned in the acknowledgement on the ack topic.
+// The time from the packet arriving at the transport to the relay pin
+// changing is kept in the HIST_RELAY histogram.
+#define RELAY_ID_LEN 24                 // longest correlation id + 1
+
+struct RelayAck {
+  char id[RELAY_ID_LEN];                // correlation id, "" if none
+  bool on;                              // relay state after the command
+  uint32_t latencyUs;                   // receive to actuation
+};
+
+//++++++++++++++++++++++
+// Forward function declarations
+void relayInit(uint8_t pin);
+bool relayCommand(const byte *payload, unsigned int length, uint32_t rxMicros,
+                  RelayAck &ack);
+bool relayOn();
+const char *relayStateName();
+
+#endif  // __RELAY_H__
@@ -0,0 +1,40 @@
+#ifndef __RTCMEM_H__
+#define __RTCMEM_H__
+
+//++++++++++++++++++++++
+// RTC user memory map
+// RTC user memory survives deep sleep and ESP.restart() but not a power
+// cycle.  Offsets are in 4 byte blocks, there are 128 blocks (512 bytes).
+// Note: blocks 0-31 are overwritten by the eboot command during an OTA
+// update, so anything that must survive an update lives at block 32 up.
+#define RTC_USER_BLOCKS 128
+#define RTC_BLOCKS(type) ((sizeof(type) + 3) / 4)
+
+#define RTC_MSG_COUNT 4         // status.msgCount
+#define RTC_RUN_TIME 12         // status.runTime (lower 32 bits)
+#define RTC_COUNTERS 32         // RtcCounters - see telemetry.h
+#define RTC_COUNTERS_END (RTC_COUNTERS + 8)
+#define RTC_HISTORY RTC_COUNTERS_END      // HistoryState - see history.cpp
+#define RTC_HISTORY_END (RTC_HISTORY + 12)
+#define RTC_TLS RTC_HISTORY_END           // TlsRtc - see mqtt_tls.cpp
+#define RTC_TLS_END (RTC_TLS + 28)
+#define RTC_OTA_REPORT RTC_TLS_END        // OtaReport - see otamode.h
+#define RTC_OTA_REPORT_END (RTC_OTA_REPORT + 6)
+#define RTC_GOVERNOR RTC_OTA_REPORT_END   // GovernorTime - see governor.h
+#define RTC_GOVERNOR_END (RTC_GOVERNOR + 4)
+#define RTC_BATTERY RTC_GOVERNOR_END      // BatteryState - see battery.h
+#define RTC_BATTERY_END (RTC_BATTERY + 2)
+#define RTC_ADAPTIVE RTC_BATTERY_END      // AdaptiveState - see adaptive.h
+#define RTC_ADAPTIVE_END (RTC_ADAPTIVE + 12)
+#define RTC_DISCOVERY RTC_ADAPTIVE_END    // DiscoveryRtc - see discovery.h
+#define RTC_DISCOVERY_END (RTC_DISCOVERY + 3)
+#define RTC_STATUS RTC_DISCOVERY_END      // StatusRtc - see statusmsg.h
+#define RTC_STATUS_END (RTC_STATUS + 5)
+#define RTC_WIFI RTC_STATUS_END           // WifiApCache - see wifiap.h
+#define RTC_WIFI_END (RTC_WIFI + 3)
+#define RTC_BROKER RTC_WIFI_END           // BrokerCache - see broker.h
+#define RTC_BROKER_END (RTC_BROKER + 6)
+
+static_assert(RTC_BROKER_END <= RTC_USER_BLOCKS, "RTC user memory map overflow");
+
+#endif  // __RTCMEM_H__
@@ -0,0 +1,157 @@
+#include "spool.h"
+#include "WiFi_Init.h"      // needed for config struct
+
+extern Config config;  // declare the external configuration struct
+
+SpoolStats spoolStats;  // instantiate the spool statistics
+
+static uint32_t spoolHead = 0;        // offset of the next record to replay
+static uint32_t spoolSize = 0;        // bytes in the queue file
+static unsigned long replayTimer = 0;
+static bool replayWaiting = false;    // first batch after a reconnect
+static bool replayedNow = false;      // the one immediate batch of this wake
+
+struct SpoolRecord {
+  uint32_t epoch;
+  uint16_t len;
+} __attribute__((packed));
+
+/*-------------------------------------------------------------------------
+ * Function to load the queue position - call after LittleFS is mounted
+ *-------------------------------------------------------------------------*/
+void spoolInit() {
+  memset(&spoolStats, 0, sizeof(spoolStats));
+  spoolHead = spoolSize = 0;
+  replayWaiting = replayedNow = false;
+  File q = LittleFS.open(SPOOL_FILE, "r");
+  if (!q) return;
+  spoolSize = q.size();
+  q.close();
+
+  File h = LittleFS.open(SPOOL_HEAD_FILE, "r");
+  if (h) {
+    if (h.read((uint8_t *)&spoolHead, sizeof(spoolHead)) != sizeof(spoolHead)) spoolHead = 0;
+    h.close();
+  }
+  if (spoolHead > spoolSize) spoolHead = 0;
+  if (spoolPending()) {
+    replayWaiting = true;
+    Serial.printf("Spool: %u bytes waiting to be replayed\r\n", spoolSize - spoolHead);
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return true while there are payloads waiting to be replayed
+ *-------------------------------------------------------------------------*/
+bool spoolPending() {
+  return spoolHead < spoolSize;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return the number of bytes waiting to be replayed
+ *-------------------------------------------------------------------------*/
+uint32_t spoolBacklog() {
+  return spoolSize - spoolHead;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to append a payload to the back of the queue
+ *-------------------------------------------------------------------------*/
+bool spoolPush(const char *msg, uint32_t epoch) {
+  SpoolRecord rec = { epoch, (uint16_t)strnlen(msg, SPOOL_MSG_MAX) };
+  if (spoolSize + sizeof(rec) + rec.len > SPOOL_MAX_BYTES) {
+    spoolStats.dropped++;
+    return false;
+  }
+  File q = LittleFS.open(SPOOL_FILE, "a");
+  if (!q) {
+    spoolStats.dropped++;
+    return false;
+  }
+  size_t n = q.write((const uint8_t *)&rec, sizeof(rec));
+  n += q.write((const uint8_t *)msg, rec.len);
+  q.close();
+  if (n != sizeof(rec) + rec.len) {
+    // a torn record would desynchronise the queue - start it over
+    Serial.println("ERROR: spool write failed - spool discarded");
+    LittleFS.remove(SPOOL_FILE);
+    LittleFS.remove(SPOOL_HEAD_FILE);
+    spoolStats.dropped++;
+    spoolHead = spoolSize = 0;
+    return false;
+  }
+  spoolSize += n;
+  spoolStats.spooled++;
+  replayWaiting = true;
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to replay the next batch of spooled payloads through send
+ * - call from loop() while connected, it returns at once until the rate
+ *   limit allows the next batch
+ * - the first batch after an outage waits a random part of the interval
+ *   so nodes that lost the same broker do not reconnect in lockstep
+ * - now = true sends the first batch of the wake at once, for deep sleep
+ *   nodes that are only awake for a sample; the passes through loop()
+ *   after it are rate limited like any other
+ * - returns the number of payloads sent
+ *-------------------------------------------------------------------------*/
+int spoolReplay(bool (*send)(const char *msg), bool now) {
+  if (!spoolPending()) return 0;
+  if (now && !replayedNow) {
+    replayedNow = true;
+    replayWaiting = false;      // the next batch waits a full interval
+  }
+  else {
+    if (replayWaiting) {
+      replayWaiting = false;
+      replayTimer = millis() - random(config.spoolInterval);
+      return 0;
+    }
+    if (millis() - replayTimer < config.spoolInterval) return 0;
+  }
+  replayTimer = millis();
+
+  File q = LittleFS.open(SPOOL_FILE, "r");
+  if (!q || !q.seek(spoolHead, SeekSet)) return 0;
+
+  int sent = 0;
+  char msg[SPOOL_MSG_MAX + 24];   // room for the "ts" field
+  while (sent < config.spoolBatch && spoolHead < spoolSize) {
+    SpoolRecord rec;
+    if (q.read((uint8_t *)&rec, sizeof(rec)) != sizeof(rec) || rec.len > SPOOL_MSG_MAX ||
+        q.read((uint8_t *)msg, rec.len) != rec.len) {
+      Serial.println("ERROR: spool corrupt - remaining payloads discarded");
+      spoolHead = spoolSize;
+      break;
+    }
+    msg[rec.len] = '\0';
+
+    // tag the payload with the time it was taken: {"host":{...,"ts":"N"}}
+    if (rec.epoch && rec.len > 2 && strcmp(msg + rec.len - 2, "}}") == 0) {
+      snprintf(msg + rec.len - 2, sizeof(msg) - rec.len + 2, ",\"ts\":\"%u\"}}", rec.epoch);
+    }
+    if (!send(msg)) break;      // broker gone again - retry from here later
+    spoolHead += sizeof(rec) + rec.len;
+    spoolStats.replayed++;
+    sent++;
+  }
+  q.close();
+
+  if (!spoolPending()) {
+    // all caught up - start with an empty queue next time
+    LittleFS.remove(SPOOL_FILE);
+    LittleFS.remove(SPOOL_HEAD_FILE);
+    spoolHead = spoolSize = 0;
+    Serial.println("Spool: replay complete");
+  }
+  else if (sent) {
+    File h = LittleFS.open(SPOOL_HEAD_FILE, "w");
+    if (h) {
+      h.write((const uint8_t *)&spoolHead, sizeof(spoolHead));
+      h.close();
+    }
+  }
+  return sent;
+}
@@ -0,0 +1,38 @@
+#ifndef __SPOOL_H__
+#define __SPOOL_H__
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+//++++++++++++++++++++++
+// Store-and-forward spool
+// While the broker is unreachable, status and temperature payloads for
+// outTopic are appended to a queue file in LittleFS instead of being
+// lost.  Once connected again they are replayed oldest first, at most
+// config.spoolBatch messages every config.spoolInterval ms, so a fleet
+// coming back online does not flood the broker.  Each record is
+//   uint32 epoch (0 = unknown) + uint16 length + payload
+// and the replay position is kept in a small head file.  New payloads
+// go to the back of the queue until it is empty to keep them in order.
+#define SPOOL_FILE "/spool/q"
+#define SPOOL_HEAD_FILE "/spool/head"
+#define SPOOL_MAX_BYTES (64UL * 1024)   // stop spooling past this size
+#define SPOOL_MSG_MAX 200               // longest payload kept
+
+struct SpoolStats {
+  uint32_t spooled;         // payloads written to the spool
+  uint32_t replayed;        // payloads replayed to the broker
+  uint32_t dropped;         // payloads lost because the spool was full
+};
+
+extern SpoolStats spoolStats;
+
+//++++++++++++++++++++++
+// Forward function declarations
+void spoolInit();
+bool spoolPending();
+uint32_t spoolBacklog();
+bool spoolPush(const char *msg, uint32_t epoch);
+int spoolReplay(bool (*send)(const char *msg), bool now);
+
+#endif  // __SPOOL_H__
@@ -0,0 +1,72 @@
+#include "statusmsg.h"
+#include "rtcmem.h"
+#include "history.h"
+#include "WiFi_Init.h"
+#include <coredecls.h>          // crc32()
+
+extern Config config;  // declare the external configuration struct
+
+static_assert(RTC_STATUS + RTC_BLOCKS(StatusRtc) <= RTC_STATUS_END,
+              "StatusRtc does not fit its RTC memory slot");
+
+StatusStats statusStats;
+
+/*-------------------------------------------------------------------------
+ * Function to hash the content of the status message
+ *-------------------------------------------------------------------------*/
+uint32_t statusHash(const char *version, const char *wifi, const char *relay) {
+  uint32_t hash = crc32(version, strlen(version) + 1);
+  hash = crc32(wifi, strlen(wifi) + 1, hash);
+  return crc32(relay, strlen(relay) + 1, hash);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to decide what the next status interval sends
+ * - without a clock every status is sent in full
+ *-------------------------------------------------------------------------*/
+StatusSend statusCheck(uint32_t hash, int rssi) {
+  StatusRtc rtc;
+  ESP.rtcUserMemoryRead(RTC_STATUS, (uint32_t *)&rtc, sizeof(rtc));
+  uint32_t now = historyNow();
+
+  StatusSend kind = STATUS_SKIP;
+  if (rtc.magic != RTC_STATUS_MAGIC || now == 0 || rtc.hash != hash ||
+      abs(rssi - rtc.rssi) >= STATUS_RSSI_DELTA ||
+      now - rtc.fullEpoch >= config.statusRefresh) {
+    kind = STATUS_FULL;
+  }
+  else if (now - rtc.sentEpoch >= config.statusHeartbeat) {
+    kind = STATUS_HEARTBEAT;
+  }
+  if (kind == STATUS_SKIP) statusStats.skipped++;
+  return kind;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to record a status message handed to the broker
+ *-------------------------------------------------------------------------*/
+void statusSent(StatusSend kind, uint32_t hash, int rssi) {
+  StatusRtc rtc;
+  ESP.rtcUserMemoryRead(RTC_STATUS, (uint32_t *)&rtc, sizeof(rtc));
+  uint32_t now = historyNow();
+  if (kind == STATUS_FULL) {
+    rtc.magic = RTC_STATUS_MAGIC;
+    rtc.hash = hash;
+    rtc.rssi = rssi;
+    rtc.fullEpoch = now;
+    statusStats.full++;
+  }
+  else {
+    statusStats.heartbeats++;
+  }
+  rtc.sentEpoch = now;
+  ESP.rtcUserMemoryWrite(RTC_STATUS, (uint32_t *)&rtc, sizeof(rtc));
+}
+
+/*-------------------------------------------------------------------------
+ * Function to send the next status in full
+ *-------------------------------------------------------------------------*/
+void statusReset() {
+  StatusRtc rtc = { 0, 0, 0, 0, 0 };
+  ESP.rtcUserMemoryWrite(RTC_STATUS, (uint32_t *)&rtc, sizeof(rtc));
+}
@@ -0,0 +1,44 @@
+#ifndef __STATUSMSG_H__
+#define __STATUSMSG_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Status message deduplication
+// The status message is only sent in full when its content changed: the
+// version, wifi state and relay are hashed, the RSSI counts as changed
+// when it moves STATUS_RSSI_DELTA from the last value sent.  msgCount is
+// left out, it changes every time.  Unchanged content is sent in full
+// again after config.statusRefresh seconds; in between a heartbeat with
+// only the message count goes out every config.statusHeartbeat seconds
+// and the other status intervals send nothing.  The hash and the times
+// are kept in RTC memory so this holds across deep sleep.
+#define STATUS_RSSI_DELTA 6               // dB
+#define RTC_STATUS_MAGIC 0x53544D31UL     // "STM1"
+
+enum StatusSend { STATUS_SKIP, STATUS_HEARTBEAT, STATUS_FULL };
+
+struct StatusRtc {                        // kept in RTC memory
+  uint32_t magic;
+  uint32_t hash;                          // content of the last full status
+  int32_t rssi;                           // RSSI in the last full status
+  uint32_t fullEpoch;                     // when the last full status went
+  uint32_t sentEpoch;                     // when the last status of any kind went
+};
+
+struct StatusStats {
+  uint32_t full;
+  uint32_t heartbeats;
+  uint32_t skipped;
+};
+
+extern StatusStats statusStats;
+
+//++++++++++++++++++++++
+// Forward function declarations
+uint32_t statusHash(const char *version, const char *wifi, const char *relay);
+StatusSend statusCheck(uint32_t hash, int rssi);
+void statusSent(StatusSend kind, uint32_t hash, int rssi);
+void statusReset();
+
+#endif  // __STATUSMSG_H__
@@ -0,0 +1,100 @@
+#include "telemetry.h"
+#include "rtcmem.h"
+
+Telemetry telemetry;  // instantiate the telemetry struct
+RtcCounters counters; // instantiate the RTC backed error counters
+
+static_assert(RTC_COUNTERS + RTC_BLOCKS(RtcCounters) <= RTC_COUNTERS_END,
+              "RtcCounters does not fit its RTC memory slot");
+
+static uint32_t loopCount = 0;        // loop iterations since last sample
+static unsigned long loopTimer = 0;   // start of the loop rate window
+static unsigned long loopTick = 0;    // micros() at the last loop pass
+static uint32_t windowMaxUs = 0;      // longest iteration in this window
+
+/*-------------------------------------------------------------------------
+ * Function to reset the watermarks - call once from setup()
+ *-------------------------------------------------------------------------*/
+void telemetryInit() {
+  memset(&telemetry, 0, sizeof(telemetry));
+  telemetry.freeHeapMin = UINT32_MAX;
+  telemetry.maxBlockMin = UINT32_MAX;
+  telemetry.loopRateMin = UINT32_MAX;
+  loopCount = 0;
+  loopTimer = millis();
+  loopTick = micros();
+}
+
+/*-------------------------------------------------------------------------
+ * Function to load the error counters from RTC memory
+ * - reset = true clears them, use after a power on or external reset
+ *-------------------------------------------------------------------------*/
+void countersInit(bool reset) {
+  ESP.rtcUserMemoryRead(RTC_COUNTERS, (uint32_t *)&counters, sizeof(counters));
+  if (reset || counters.magic != RTC_COUNTERS_MAGIC) {
+    memset(&counters, 0, sizeof(counters));
+    counters.magic = RTC_COUNTERS_MAGIC;
+    ESP.rtcUserMemoryWrite(RTC_COUNTERS, (uint32_t *)&counters, sizeof(counters));
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to increment an error counter and save it to RTC memory
+ *-------------------------------------------------------------------------*/
+void countersIncrement(CounterId id) {
+  switch (id) {
+    case COUNT_PUBLISH_FAIL: counters.publishFails++; break;
+    case COUNT_MQTT_RECONNECT: counters.mqttReconnects++; break;
+  }
+  ESP.rtcUserMemoryWrite(RTC_COUNTERS, (uint32_t *)&counters, sizeof(counters));
+}
+
+/*-------------------------------------------------------------------------
+ * Function to count one pass of the main loop
+ *-------------------------------------------------------------------------*/
+void telemetryLoopTick() {
+  unsigned long now = micros();
+  uint32_t iteration = now - loopTick;
+  loopTick = now;
+  loopCount++;
+  if (iteration > windowMaxUs) windowMaxUs = iteration;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to sample the heap and stack and update the watermarks
+ *-------------------------------------------------------------------------*/
+void telemetrySample() {
+  // read all three heap values in one pass so they are consistent
+  ESP.getHeapStats(&telemetry.freeHeap, &telemetry.maxBlock, &telemetry.frag);
+  telemetry.freeStack = ESP.getFreeContStack();
+
+  unsigned long elapsed = millis() - loopTimer;
+  telemetry.loopRate = elapsed ? (uint32_t)((uint64_t)loopCount * 1000 / elapsed) : 0;
+  loopCount = 0;
+  loopTimer = millis();
+  telemetry.loopMaxUs = windowMaxUs;
+  windowMaxUs = 0;
+  if (telemetry.loopMaxUs > telemetry.loopMaxUsAll) telemetry.loopMaxUsAll = telemetry.loopMaxUs;
+
+  if (telemetry.freeHeap < telemetry.freeHeapMin) telemetry.freeHeapMin = telemetry.freeHeap;
+  if (telemetry.maxBlock < telemetry.maxBlockMin) telemetry.maxBlockMin = telemetry.maxBlock;
+  if (telemetry.frag > telemetry.fragMax) telemetry.fragMax = telemetry.frag;
+  // the first sample only covers the part of setup() spent in loop()
+  if (telemetry.samples > 0) {
+    if (telemetry.loopRate < telemetry.loopRateMin) telemetry.loopRateMin = telemetry.loopRate;
+    if (telemetry.loopRate > telemetry.loopRateMax) telemetry.loopRateMax = telemetry.loopRate;
+  }
+  telemetry.samples++;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to assemble the compact metrics message
+ * - returns the snprintf() result, >= len means the message was truncated
+ *-------------------------------------------------------------------------*/
+int telemetryFormat(char *msg, size_t len, const char *host) {
+  return snprintf(msg, len,
+          "{\"%s\":{\"heap\":%u,\"hmin\":%u,\"blk\":%u,\"bmin\":%u,\"frag\":%u,\"fmax\":%u,\"stk\":%u,\"lps\":%u}}",
+          host, telemetry.freeHeap, telemetry.freeHeapMin, telemetry.maxBlock,
+          telemetry.maxBlockMin, telemetry.frag, telemetry.fragMax,
+          telemetry.freeStack, telemetry.loopRate);
+}
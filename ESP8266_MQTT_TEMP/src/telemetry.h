@@ -0,0 +1,54 @@
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Memory health telemetry
+// Samples the heap, the largest free block, heap fragmentation, the loop
+// stack high-water mark and the main loop iteration rate.  Min/max
+// watermarks are kept since boot so slow leaks and fragmentation show up
+// in the metrics message long before they cause a reset.
+#define METRICS_INTERVAL 60000UL    // metrics message interval
+
+struct Telemetry {            // memory health sample and watermarks
+  uint32_t freeHeap;          // bytes of free heap
+  uint32_t freeHeapMin;
+  uint32_t maxBlock;          // largest allocatable block
+  uint32_t maxBlockMin;
+  uint8_t frag;               // heap fragmentation in %
+  uint8_t fragMax;
+  uint32_t freeStack;         // loop stack never used (high-water mark)
+  uint32_t loopRate;          // main loop iterations per second
+  uint32_t loopRateMin;
+  uint32_t loopRateMax;
+  uint32_t loopMaxUs;         // longest loop iteration in the last window
+  uint32_t loopMaxUsAll;      // longest loop iteration since boot
+  uint32_t samples;           // number of samples taken
+};
+
+// Error counters kept in RTC memory so they survive the ESP.restart()
+// that follows an MQTT failure.  Reset on power on.
+#define RTC_COUNTERS_MAGIC 0x434E5431UL   // "CNT1"
+
+struct RtcCounters {
+  uint32_t magic;
+  uint32_t publishFails;      // MQTT publish failures
+  uint32_t mqttReconnects;    // MQTT connections lost or failed
+};
+
+enum CounterId { COUNT_PUBLISH_FAIL, COUNT_MQTT_RECONNECT };
+
+extern Telemetry telemetry;
+extern RtcCounters counters;
+
+//++++++++++++++++++++++
+// Forward function declarations
+void telemetryInit();
+void countersInit(bool reset);
+void countersIncrement(CounterId id);
+void telemetryLoopTick();
+void telemetrySample();
+int telemetryFormat(char *msg, size_t len, const char *host);
+
+#endif  // __TELEMETRY_H__
@@ -0,0 +1,56 @@
+#ifndef __TOPICS_H__
+#define __TOPICS_H__
+
+#include <stddef.h>
+#include "WiFi_Init.h"      // needed for status struct
+
+//++++++++++++++++++++++
+// MQTT topic table
+// Every topic is topicPreamble + status.host + a fixed suffix.  The
+// segments are compile-time constants, so the worst case length of each
+// path is checked by the compiler.  The paths are assembled once into
+// topicArena by mqttTopicInit() - add a new topic by adding an id to
+// TopicId and its suffix to topicTable.
+#define HOST_NAME_LEN 10          // "ESP_" + last 3 MAC bytes in HEX
+#define TOPIC_SIZE 40             // bytes reserved per topic path
+
+enum TopicId {
+  TOPIC_WILL,
+  TOPIC_CMD,
+  TOPIC_STATUS,
+  TOPIC_METRICS,
+  TOPIC_ACK,
+  TOPIC_COUNT                     // must be last
+};
+
+struct TopicSegment {
+  const char *suffix;
+  size_t len;
+};
+#define TOPIC_SEGMENT(s) { s, sizeof(s) - 1 }
+
+constexpr char topicPreamble[] = "MyIoT/";
+constexpr TopicSegment topicTable[TOPIC_COUNT] = {
+  TOPIC_SEGMENT("/will"),         // TOPIC_WILL
+  TOPIC_SEGMENT("/cmd"),          // TOPIC_CMD
+  TOPIC_SEGMENT("/status"),       // TOPIC_STATUS
+  TOPIC_SEGMENT("/metrics"),      // TOPIC_METRICS
+  TOPIC_SEGMENT("/ack"),          // TOPIC_ACK
+};
+
+// longest suffix in topicTable starting at entry i
+constexpr size_t topicSuffixMax(size_t i = 0) {
+  return i >= TOPIC_COUNT ? 0 :
+    (topicTable[i].len > topicSuffixMax(i + 1) ?
+     topicTable[i].len : topicSuffixMax(i + 1));
+}
+
+static_assert(sizeof(topicPreamble) - 1 + HOST_NAME_LEN + topicSuffixMax() < TOPIC_SIZE,
+              "MQTT topic path does not fit in TOPIC_SIZE");
+static_assert(sizeof(Status::host) > HOST_NAME_LEN,
+              "status.host is too small for the generated hostname");
+
+// Returns the full topic path for id - valid after mqttTopicInit()
+const char *mqttTopic(TopicId id);
+
+#endif  // __TOPICS_H__
@@ -0,0 +1,641 @@
+#include "web.h"
+#include "web_assets.h"     // gzipped web/ files - see tools/web_assets.py
+#include "WiFi_Init.h"      // needed for status struct
+#include "telemetry.h"
+#include "history.h"
+#include "spool.h"
+#include "inflight.h"
+#include "mqtt_transport.h"
+#include "delta.h"
+#include "otamode.h"
+#include "governor.h"
+#include "statusmsg.h"
+#include "histogram.h"
+#include "wifiap.h"
+#include "broker.h"
+#include "fixedpoint.h"
+#include <ESP8266WiFi.h>
+#include <Updater.h>
+#include <DallasTemperature.h>
+
+extern Status status;             // declare the external status struct
+extern int numDevices;            // number of DS18B20 sensors found
+extern DeviceAddress tempSensor[];  // DS18B20 ROM addresses
+extern uint8_t tempResolution[];    // DS18B20 resolution in bits
+extern const char version[];
+
+// response state shared between the chunk callbacks of one request
+struct LineCursor {
+  LineSource source;
+  char line[WEB_LINE_SIZE];
+  size_t len;                 // bytes in line
+  size_t pos;                 // bytes of line already sent
+  bool done;
+};
+
+/*-------------------------------------------------------------------------
+ * Function to start a chunked response fed line by line from source
+ * - each chunk is filled with as many lines as fit, a line that does not
+ *   fit is carried over to the next chunk
+ *-------------------------------------------------------------------------*/
+AsyncWebServerResponse *beginLineResponse(AsyncWebServerRequest *request,
+                                          const char *contentType,
+                                          LineSource source) {
+  std::shared_ptr<LineCursor> cursor = std::make_shared<LineCursor>();
+  cursor->source = source;
+  cursor->len = 0;
+  cursor->pos = 0;
+  cursor->done = false;
+
+  return request->beginChunkedResponse(contentType,
+    [cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      governorPulse(CPU_HINT_WEB);    // formatting the chunk is CPU bound
+      size_t n = 0;
+      while (n < maxLen) {
+        if (cursor->pos == cursor->len) {
+          if (cursor->done) break;
+          size_t len = cursor->source(cursor->line, sizeof(cursor->line));
+          if (len == 0) {
+            cursor->done = true;
+            break;
+          }
+          // snprintf() style sources return the untruncated length
+          if (len >= sizeof(cursor->line)) len = sizeof(cursor->line) - 1;
+          cursor->len = len;
+          cursor->pos = 0;
+        }
+        size_t chunk = cursor->len - cursor->pos;
+        if (chunk > maxLen - n) chunk = maxLen - n;
+        memcpy(buffer + n, cursor->line + cursor->pos, chunk);
+        cursor->pos += chunk;
+        n += chunk;
+      }
+      return n;
+    });
+}
+
+//++++++++++++++++++++++++++++++++++++
+// Register the pre-compressed static assets from web_assets.h
+// - sent straight from flash with Content-Encoding: gzip
+// - the strong ETag lets browsers revalidate with a 304 and no body
+void webAssetsInit(AsyncWebServer *server) {
+  for (size_t i = 0; i < WEB_ASSET_COUNT; i++) {
+    const WebAsset *asset = &webAssets[i];
+    server->on(asset->path, HTTP_GET, [asset](AsyncWebServerRequest *request) {
+      AsyncWebHeader *match = request->getHeader("If-None-Match");
+      if (match && match->value() == asset->etag) {
+        AsyncWebServerResponse *response = request->beginResponse(304);
+        response->addHeader("ETag", asset->etag);
+        request->send(response);
+        return;
+      }
+      AsyncWebServerResponse *response =
+        request->beginResponse_P(200, asset->contentType, asset->data, asset->len);
+      response->addHeader("Content-Encoding", "gzip");
+      response->addHeader("ETag", asset->etag);
+      response->addHeader("Cache-Control", "no-cache");   // always revalidate
+      request->send(response);
+    });
+  }
+}
+
+//++++++++++++++++++++++
+// Prometheus metric table
+// Values are returned as fixed-point integers scaled by 10^decimals,
+// PROM_NAN for a sample with no value.
+// perSensor families emit one sample per DS18B20 labelled with its index
+// and ROM address.
+#define PROM_NAN INT32_MIN
+
+struct PromFamily {
+  const char *name;
+  const char *type;
+  const char *help;
+  uint8_t decimals;
+  bool perSensor;
+  int32_t (*value)(int i);
+};
+
+static const PromFamily promFamilies[] = {
+  { "esp_uptime_seconds", "gauge", "Seconds since the last reset", 0, false,
+    [](int) -> int32_t { return millis() / 1000; } },
+  { "esp_mqtt_messages_total", "counter", "MQTT status messages sent", 0, false,
+    [](int) -> int32_t { return status.msgCount; } },
+  { "esp_mqtt_publish_failures_total", "counter", "MQTT publish failures", 0, false,
+    [](int) -> int32_t { return counters.publishFails; } },
+  { "esp_mqtt_reconnects_total", "counter", "MQTT connections lost or failed", 0, false,
+    [](int) -> int32_t { return counters.mqttReconnects; } },
+  { "esp_mqtt_inflight", "gauge", "QoS 1 messages awaiting a PUBACK", 0, false,
+    [](int) -> int32_t { return inflightCount(); } },
+  { "esp_mqtt_puback_total", "counter", "QoS 1 messages acknowledged", 0, false,
+    [](int) -> int32_t { return inflightStats.acked; } },
+  { "esp_mqtt_retransmits_total", "counter", "QoS 1 messages resent with DUP", 0, false,
+    [](int) -> int32_t { return inflightStats.retries; } },
+  { "esp_mqtt_puback_max_ms", "gauge", "Longest wait for a PUBACK", 0, false,
+    [](int) -> int32_t { return inflightStats.ackMaxMs; } },
+  { "esp_tls_handshakes_total", "counter", "MQTT TLS handshakes", 0, false,
+    [](int) -> int32_t { return tlsStats.handshakes; } },
+  { "esp_tls_resumed_total", "counter", "MQTT TLS sessions resumed from RTC", 0, false,
+    [](int) -> int32_t { return tlsStats.resumed; } },
+  { "esp_tls_handshake_ms", "gauge", "Duration of the last TLS handshake", 0, false,
+    [](int) -> int32_t { return tlsStats.lastMs; } },
+  { "esp_cpu_low_ms_total", "counter", "Time at 80 MHz since power on", 0, false,
+    [](int) -> int32_t { GovernorTime t; governorTotal(t); return t.msLow; } },
+  { "esp_cpu_high_ms_total", "counter", "Time at 160 MHz since power on", 0, false,
+    [](int) -> int32_t { GovernorTime t; governorTotal(t); return t.msHigh; } },
+  { "esp_cpu_switches_total", "counter", "CPU frequency changes since power on", 0, false,
+    [](int) -> int32_t { GovernorTime t; governorTotal(t); return t.switches; } },
+  { "esp_spool_backlog_bytes", "gauge", "Spooled bytes waiting for replay", 0, false,
+    [](int) -> int32_t { return spoolBacklog(); } },
+  { "esp_spool_messages_total", "counter", "Messages spooled while offline", 0, false,
+    [](int) -> int32_t { return spoolStats.spooled; } },
+  { "esp_spool_replayed_total", "counter", "Spooled messages replayed", 0, false,
+    [](int) -> int32_t { return spoolStats.replayed; } },
+  { "esp_spool_dropped_total", "counter", "Messages lost with the spool full", 0, false,
+    [](int) -> int32_t { return spoolStats.dropped; } },
+  { "esp_status_full_total", "counter", "Full status messages sent since boot", 0, false,
+    [](int) -> int32_t { return statusStats.full; } },
+  { "esp_status_heartbeat_total", "counter", "Heartbeat status messages sent since boot", 0, false,
+    [](int) -> int32_t { return statusStats.heartbeats; } },
+  { "esp_status_skipped_total", "counter", "Unchanged status messages not sent since boot", 0, false,
+    [](int) -> int32_t { return statusStats.skipped; } },
+  { "esp_broker_lookups_total", "counter", "Broker DNS or mDNS lookups since boot", 0, false,
+    [](int) -> int32_t { return brokerStats.lookups; } },
+  { "esp_broker_cache_hits_total", "counter", "Connects to the cached broker address since boot", 0, false,
+    [](int) -> int32_t { return brokerStats.cacheHits; } },
+  { "esp_wifi_connects_total", "counter", "WiFi connects since boot", 0, false,
+    [](int) -> int32_t { return wifiStats.connects; } },
+  { "esp_wifi_scans_total", "counter", "WiFi scans since boot", 0, false,
+    [](int) -> int32_t { return wifiStats.scans; } },
+  { "esp_wifi_roams_total", "counter", "Moves to a stronger AP since boot", 0, false,
+    [](int) -> int32_t { return wifiStats.roams; } },
+  { "esp_wifi_rssi_dbm", "gauge", "WiFi signal strength", 0, false,
+    [](int) -> int32_t { return WiFi.RSSI(); } },
+  { "esp_vcc_volts", "gauge", "Supply voltage on A0", 2, false,
+    [](int) -> int32_t { return (int32_t)lroundf(status.vcc * 100); } },
+  { "esp_battery_percent", "gauge", "Estimated battery capacity remaining", 0, false,
+    [](int) -> int32_t { return status.battery; } },
+  { "esp_heap_free_bytes", "gauge", "Free heap", 0, false,
+    [](int) -> int32_t { return ESP.getFreeHeap(); } },
+  { "esp_heap_free_min_bytes", "gauge", "Lowest free heap sampled since boot", 0, false,
+    [](int) -> int32_t { return telemetry.samples ? telemetry.freeHeapMin : 0; } },
+  { "esp_heap_max_block_bytes", "gauge", "Largest free heap block", 0, false,
+    [](int) -> int32_t { return ESP.getMaxFreeBlockSize(); } },
+  { "esp_heap_fragmentation_percent", "gauge", "Heap fragmentation", 0, false,
+    [](int) -> int32_t { return ESP.getHeapFragmentation(); } },
+  { "esp_stack_free_bytes", "gauge", "Loop stack never used", 0, false,
+    [](int) -> int32_t { return telemetry.freeStack; } },
+  { "esp_loop_rate_hz", "gauge", "Main loop iterations per second", 0, false,
+    [](int) -> int32_t { return telemetry.loopRate; } },
+  { "esp_loop_max_microseconds", "gauge", "Longest main loop iteration since boot", 0, false,
+    [](int) -> int32_t { return telemetry.loopMaxUsAll; } },
+  { "esp_temperature_celsius", "gauge", "DS18B20 temperature", 2, true,
+    [](int i) -> int32_t {
+      return status.tempRaw[i] == TEMP_RAW_INVALID ? PROM_NAN : tempCentiC(status.tempRaw[i]);
+    } },
+  { "esp_sensor_read_errors_total", "counter", "DS18B20 read errors", 0, true,
+    [](int i) -> int32_t { return status.tempErrors[i]; } },
+};
+#define PROM_FAMILIES (sizeof(promFamilies) / sizeof(promFamilies[0]))
+
+// The latency histograms follow the families as one histogram family
+// labelled by operation, the bounds are exported in seconds
+#define PROM_HIST_NAME "esp_latency_seconds"
+#define PROM_HIST_LINES (HIST_BUCKETS + 2)    // buckets, _sum, _count
+
+// position of a /metrics response within promFamilies
+struct PromCursor {
+  unsigned int family;
+  int line;                   // 0 = HELP, 1 = TYPE, 2.. = samples
+};
+
+/*-------------------------------------------------------------------------
+ * Function to write the next line of the Prometheus text exposition
+ *-------------------------------------------------------------------------*/
+static size_t promNextLine(PromCursor &cursor, char *line, size_t len) {
+  while (cursor.family < PROM_FAMILIES) {
+    const PromFamily &f = promFamilies[cursor.family];
+    int samples = f.perSensor ? numDevices : 1;
+    int n = cursor.line++;
+
+    if (n == 0) return snprintf(line, len, "# HELP %s %s\n", f.name, f.help);
+    if (n == 1) return snprintf(line, len, "# TYPE %s %s\n", f.name, f.type);
+    if (n - 2 < samples) {
+      int i = n - 2;
+      char value[16];
+      int32_t v = f.value(i);
+      if (v == PROM_NAN) strcpy(value, "NaN");
+      else formatFixed(value, sizeof(value), v, f.decimals);
+      if (!f.perSensor) return snprintf(line, len, "%s %s\n", f.name, value);
+
+      const uint8_t *rom = tempSensor[i];
+      return snprintf(line, len,
+        "%s{sensor=\"%i\",rom=\"%02X%02X%02X%02X%02X%02X%02X%02X\"} %s\n",
+        f.name, i, rom[0], rom[1], rom[2], rom[3], rom[4], rom[5], rom[6], rom[7], value);
+    }
+    cursor.family++;          // this family is complete
+    cursor.line = 0;
+  }
+  if (cursor.family == PROM_FAMILIES) {
+    int n = cursor.line++;
+    if (n == 0) return snprintf(line, len, "# HELP " PROM_HIST_NAME " Operation durations\n");
+    if (n == 1) return snprintf(line, len, "# TYPE " PROM_HIST_NAME " histogram\n");
+    n -= 2;
+    int id = n / PROM_HIST_LINES;
+    int b = n % PROM_HIST_LINES;
+    if (id < HIST_COUNT) {
+      const Histogram &h = histograms[id];
+      const char *op = histNames[id];
+      char value[16];
+      if (b < HIST_BUCKETS) {   // cumulative, the last one is +Inf
+        uint32_t total = 0;
+        for (int i = 0; i <= b; i++) total += h.counts[i];
+        if (b == HIST_BUCKETS - 1) strcpy(value, "+Inf");
+        else formatFixed(value, sizeof(value), histBound(b), 6);
+        return snprintf(line, len, PROM_HIST_NAME "_bucket{op=\"%s\",le=\"%s\"} %u\n",
+                        op, value, total);
+      }
+      if (b == HIST_BUCKETS) {
+        // split in 32 bit halves - no 64 bit printf in the core
+        snprintf(value, sizeof(value), "%u.%06u", (uint32_t)(h.sumUs / 1000000),
+                 (uint32_t)(h.sumUs % 1000000));
+        return snprintf(line, len, PROM_HIST_NAME "_sum{op=\"%s\"} %s\n", op, value);
+      }
+      return snprintf(line, len, PROM_HIST_NAME "_count{op=\"%s\"} %u\n", op, h.count);
+    }
+    cursor.family++;          // the histograms are complete
+    cursor.line = 0;
+  }
+  return 0;
+}
+
+//++++++++++++++++++++++++++++++++++++
+// Register the Prometheus /metrics endpoint
+void webMetricsInit(AsyncWebServer *server) {
+  server->on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+    PromCursor cursor = { 0, 0 };
+    request->send(beginLineResponse(request, "text/plain; version=0.0.4",
+      [cursor](char *line, size_t len) mutable -> size_t {
+        return promNextLine(cursor, line, len);
+      }));
+  });
+}
+
+//++++++++++++++++++++++
+// JSON REST API
+// Each response is produced as a sequence of small JSON fragments by a
+// step counter, straight from the status struct and the sensor table.
+
+/*-------------------------------------------------------------------------
+ * Function to write the next fragment of the /api/status document
+ *-------------------------------------------------------------------------*/
+static size_t apiStatusNext(int &step, char *line, size_t len) {
+  switch (step++) {
+    case 0:
+      return snprintf(line, len,
+        "{\"host\":\"%s\",\"version\":\"%s\",\"ip\":\"%u.%u.%u.%u\",",
+        status.host, version, status.ip[0], status.ip[1], status.ip[2], status.ip[3]);
+    case 1:
+      return snprintf(line, len,
+        "\"wifi\":\"%s\",\"rssi\":%i,\"relay\":\"%s\",\"vcc\":%.2f,\"battery\":%i,",
+        status.wifi, WiFi.RSSI(), status.relay, status.vcc, status.battery);
+    case 2:
+      return snprintf(line, len,
+        "\"runTime\":%lu,\"uptime\":%lu,\"msgCount\":%u,\"sensors\":%i,",
+        status.runTime, millis() / 1000, status.msgCount, numDevices);
+    case 3:
+      return snprintf(line, len,
+        "\"heap\":%u,\"heapMin\":%u,\"maxBlock\":%u,\"frag\":%u,"
+        "\"publishFails\":%u,\"reconnects\":%u}\n",
+        ESP.getFreeHeap(), telemetry.samples ? telemetry.freeHeapMin : 0,
+        ESP.getMaxFreeBlockSize(), ESP.getHeapFragmentation(),
+        counters.publishFails, counters.mqttReconnects);
+    default:
+      return 0;
+  }
+}
+
+/*-------------------------------------------------------------------------
+ * Function to write the next entry of the /api/sensors array
+ *-------------------------------------------------------------------------*/
+static size_t apiSensorsNext(int &step, char *line, size_t len) {
+  int i = step++;
+  if (i > numDevices) return 0;
+  if (i == numDevices) return snprintf(line, len, "%s]\n", numDevices ? "" : "[");
+
+  const uint8_t *rom = tempSensor[i];
+  char degC[12] = "null", degF[12] = "null";
+  if (status.tempRaw[i] != TEMP_RAW_INVALID) {
+    formatTempC(degC, sizeof(degC), status.tempRaw[i]);
+    formatTempF(degF, sizeof(degF), status.tempRaw[i]);
+  }
+  return snprintf(line, len,
+    "%s{\"index\":%i,\"rom\":\"%02X%02X%02X%02X%02X%02X%02X%02X\","
+    "\"degC\":%s,\"degF\":%s,\"resolution\":%u,\"errors\":%u}",
+    i ? "," : "[", i, rom[0], rom[1], rom[2], rom[3], rom[4], rom[5], rom[6], rom[7],
+    degC, degF, tempResolution[i], status.tempErrors[i]);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to write the next entry of the /api/latency array
+ * - times are in microseconds
+ *-------------------------------------------------------------------------*/
+static size_t apiLatencyNext(int &step, char *line, size_t len) {
+  int i = step++;
+  if (i > HIST_COUNT) return 0;
+  if (i == HIST_COUNT) return snprintf(line, len, "]\n");
+
+  HistId id = (HistId)i;
+  const Histogram &h = histograms[i];
+  return snprintf(line, len,
+    "%s{\"op\":\"%s\",\"count\":%u,\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u}",
+    i ? "," : "[", histNames[i], h.count, histPercentile(id, 50),
+    histPercentile(id, 90), histPercentile(id, 99), h.maxUs);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to write the next entry of the /api/wifi array
+ * - the recent connects, newest first
+ *-------------------------------------------------------------------------*/
+static size_t apiWifiNext(int &step, char *line, size_t len) {
+  int i = step++;
+  if (i > 0 && !wifiApLog(i - 1)) return 0;
+  const WifiConnect *c = wifiApLog(i);
+  if (!c) return snprintf(line, len, "%s]\n", i ? "" : "[");
+  return snprintf(line, len,
+    "%s{\"ms\":%u,\"bssid\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"channel\":%u,"
+    "\"rssi\":%i,\"network\":%u,\"join\":\"%s\",\"durationMs\":%u}",
+    i ? "," : "[", c->ms, c->bssid[0], c->bssid[1], c->bssid[2], c->bssid[3],
+    c->bssid[4], c->bssid[5], c->channel, c->rssi, c->credential,
+    wifiJoinName(c->join), c->durationMs);
+}
+
+//++++++++++++++++++++++++++++++++++++
+// Register the read-only JSON endpoints
+void webApiInit(AsyncWebServer *server) {
+  server->on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+    int step = 0;
+    request->send(beginLineResponse(request, "application/json",
+      [step](char *line, size_t len) mutable -> size_t {
+        return apiStatusNext(step, line, len);
+      }));
+  });
+
+  server->on("/api/sensors", HTTP_GET, [](AsyncWebServerRequest *request) {
+    int step = 0;
+    request->send(beginLineResponse(request, "application/json",
+      [step](char *line, size_t len) mutable -> size_t {
+        return apiSensorsNext(step, line, len);
+      }));
+  });
+
+  server->on("/api/latency", HTTP_GET, [](AsyncWebServerRequest *request) {
+    int step = 0;
+    request->send(beginLineResponse(request, "application/json",
+      [step](char *line, size_t len) mutable -> size_t {
+        return apiLatencyNext(step, line, len);
+      }));
+  });
+
+  server->on("/api/wifi", HTTP_GET, [](AsyncWebServerRequest *request) {
+    int step = 0;
+    request->send(beginLineResponse(request, "application/json",
+      [step](char *line, size_t len) mutable -> size_t {
+        return apiWifiNext(step, line, len);
+      }));
+  });
+}
+
+//++++++++++++++++++++++
+// History range queries
+#define HISTORY_DEFAULT_WINDOW 86400UL    // seconds returned without from=
+
+// state of one /api/history response
+struct HistoryQuery {
+  HistoryCursor cursor;
+  bool open;
+  int step;                     // 0 = header, 1 = rows, 2 = done
+  bool first;                   // no row sent yet
+};
+
+/*-------------------------------------------------------------------------
+ * Function to write the next row of an /api/history response
+ * - rows are [epoch, degC, ...] straight from the decoded records
+ *-------------------------------------------------------------------------*/
+static size_t historyNextLine(HistoryQuery &q, char *line, size_t len) {
+  if (q.step == 0) {
+    q.step = 1;
+    return snprintf(line, len, "{\"from\":%u,\"to\":%u,\"rows\":[",
+                    q.cursor.from, q.cursor.to);
+  }
+  if (q.step == 1) {
+    if (q.open && historyNext(q.cursor)) {
+      int n = snprintf(line, len, "%s[%u", q.first ? "" : ",", q.cursor.epoch);
+      for (int c = 0; c < q.cursor.channels && n < (int)len; c++) {
+        int16_t v = q.cursor.values[c];
+        if (v == TEMP_RAW_INVALID) n += snprintf(line + n, len - n, ",null");
+        else {
+          n += snprintf(line + n, len - n, ",");
+          n += formatTempC(line + n, len - n, v);
+        }
+      }
+      if (n < (int)len) n += snprintf(line + n, len - n, "]");
+      q.first = false;
+      return n;
+    }
+    q.step = 2;
+    return snprintf(line, len, "]}\n");
+  }
+  return 0;
+}
+
+//++++++++++++++++++++++++++++++++++++
+// Register /api/history?from=&to= - epoch seconds, to defaults to now
+void webHistoryInit(AsyncWebServer *server) {
+  server->on("/api/history", HTTP_GET, [](AsyncWebServerRequest *request) {
+    uint32_t to = historyNow();
+    if (request->hasParam("to")) to = strtoul(request->getParam("to")->value().c_str(), NULL, 10);
+    uint32_t from = to > HISTORY_DEFAULT_WINDOW ? to - HISTORY_DEFAULT_WINDOW : 0;
+    if (request->hasParam("from")) from = strtoul(request->getParam("from")->value().c_str(), NULL, 10);
+
+    std::shared_ptr<HistoryQuery> q = std::make_shared<HistoryQuery>();
+    q->open = historyOpen(q->cursor, from, to);
+    q->step = 0;
+    q->first = true;
+    request->send(beginLineResponse(request, "application/json",
+      [q](char *line, size_t len) -> size_t {
+        return historyNextLine(*q, line, len);
+      }));
+  });
+}
+
+//++++++++++++++++++++++
+// Server-Sent Events live readings stream
+AsyncEventSource events("/events");
+static uint32_t eventId = 0;      // id of the last reading event sent
+// the clients being served, so a stalled one can be dropped on its own
+static AsyncEventSourceClient *sseClients[SSE_MAX_CLIENTS];
+
+/*-------------------------------------------------------------------------
+ * Function to check the list against the clients still connected
+ * - live is events.count(), less any client not listed yet
+ * - the library deletes a client as soon as its connection closes, so
+ *   fewer live than listed means an entry points at a deleted client;
+ *   not knowing which, every client is closed and reconnects
+ * - returns false when the clients were closed
+ *-------------------------------------------------------------------------*/
+static bool ssePrune(size_t live) {
+  size_t listed = 0;
+  for (AsyncEventSourceClient *c : sseClients) {
+    if (c) listed++;
+  }
+  if (live >= listed) return true;
+  Serial.println("SSE client gone - reconnecting the others");
+  memset(sseClients, 0, sizeof(sseClients));
+  events.close();
+  return false;
+}
+
+//++++++++++++++++++++++++++++++++++++
+// Register the /events Server-Sent Events stream
+void webEventsInit(AsyncWebServer *server) {
+  events.onConnect([](AsyncEventSourceClient *client) {
+    if (!ssePrune(events.count() - 1)) return;     // closed this one too
+    AsyncEventSourceClient **slot = nullptr;
+    for (AsyncEventSourceClient *&c : sseClients) {
+      if (!c) slot = &c;
+    }
+    if (!slot) {
+      client->close();        // too many listeners - refuse this one
+      return;
+    }
+    *slot = client;
+    // set the reconnect delay, a new client waits for the next reading
+    client->send("hello", NULL, eventId, SSE_RETRY_MS);
+  });
+  server->addHandler(&events);
+}
+
+/*-------------------------------------------------------------------------
+ * Function to push the latest readings to every /events client
+ * - called after each sample; only queues data, it never waits on a client
+ *-------------------------------------------------------------------------*/
+void webEventsSendReadings() {
+  size_t live = events.count();
+  if (live == 0) {                  // nobody listening - skip the formatting
+    memset(sseClients, 0, sizeof(sseClients));
+    return;
+  }
+  if (!ssePrune(live)) return;
+
+  // a stalled client has stopped draining its queue - drop it rather
+  // than let its backlog grow, the browser reconnects on its own
+  for (AsyncEventSourceClient *&c : sseClients) {
+    if (c && c->packetsWaiting() >= SSE_MAX_BACKLOG) {
+      Serial.println("SSE client stalled - closing it");
+      c->close();
+      c = nullptr;
+    }
+  }
+
+  char msg[WEB_LINE_SIZE];
+  int n = snprintf(msg, sizeof(msg), "{\"t\":%lu,\"vcc\":%.2f,\"rssi\":%i,\"c\":[",
+                   millis(), status.vcc, WiFi.RSSI());
+  for (int i = 0; i < numDevices && n < (int)sizeof(msg); i++) {
+    n += snprintf(msg + n, sizeof(msg) - n, "%s", i ? "," : "");
+    if (n >= (int)sizeof(msg)) break;
+    if (status.tempRaw[i] == TEMP_RAW_INVALID) n += snprintf(msg + n, sizeof(msg) - n, "null");
+    else n += formatTempC(msg + n, sizeof(msg) - n, status.tempRaw[i]);
+  }
+  if (n < (int)sizeof(msg)) n += snprintf(msg + n, sizeof(msg) - n, "]}");
+  if (n >= (int)sizeof(msg)) {
+    Serial.println("ERROR: readings event truncated");
+    return;
+  }
+  events.send(msg, "reading", ++eventId);
+}
+
+//++++++++++++++++++++++
+// Delta firmware update - POST the .delta made by tools/ota_image.py to
+// /update-delta, it is rebuilt against the running sketch straight into
+// the OTA partition.  Update.setMD5() checks the result before it is
+// committed, a bad or mismatched delta leaves the running sketch alone.
+static DeltaDecoder otaDelta;
+static const char *otaDeltaError = nullptr;
+static bool otaDeltaComplete = false;   // image rebuilt and verified
+
+static void md5Hex(const uint8_t md5[16], char hex[33]) {
+  for (int i = 0; i < 16; i++) sprintf(hex + 2 * i, "%02x", md5[i]);
+}
+
+static bool otaDeltaBegin(const DeltaHeader &header) {
+  // the delta only applies to the sketch it was made from
+  char hex[33];
+  md5Hex(header.baseMd5, hex);
+  if (header.baseSize != ESP.getSketchSize() || !ESP.getSketchMD5().equals(hex)) {
+    Serial.println("ERROR: delta was made for a different sketch");
+    return false;
+  }
+  if (!Update.begin(header.targetSize, U_FLASH)) {
+    Update.printError(Serial);
+    return false;
+  }
+  md5Hex(header.targetMd5, hex);
+  Update.setMD5(hex);
+  Serial.printf("Delta update: %u byte sketch\r\n", header.targetSize);
+  return true;
+}
+
+static bool otaDeltaReadBase(uint32_t offset, uint8_t *buf, size_t len) {
+  return ESP.flashRead(offset, buf, len);   // the sketch image starts at 0
+}
+
+static bool otaDeltaWrite(const uint8_t *buf, size_t len) {
+  return Update.write((uint8_t *)buf, len) == len;
+}
+
+static void otaDeltaUpload(AsyncWebServerRequest *request, String filename,
+                           size_t index, uint8_t *data, size_t len, bool final) {
+  if (index == 0) {
+    Update.runAsync(true);
+    deltaInit(otaDelta, otaDeltaBegin, otaDeltaReadBase, otaDeltaWrite);
+    otaDeltaError = nullptr;
+    otaDeltaComplete = false;
+  }
+  if (otaDeltaError) return;      // already failed - drain the upload
+
+  if (!deltaFeed(otaDelta, data, len)) otaDeltaError = otaDelta.error;
+  else if (final && !deltaDone(otaDelta)) otaDeltaError = "delta incomplete";
+  else if (final && !Update.end()) otaDeltaError = "image verification failed";
+  else if (final) otaDeltaComplete = true;
+
+  if (otaDeltaError) {
+    Serial.printf("ERROR: delta update - %s\r\n", otaDeltaError);
+    if (Update.isRunning()) Update.end(false);  // unfinished - discarded
+  }
+}
+
+//++++++++++++++++++++++++++++++++++++
+// Register the /update-delta firmware upload
+void webDeltaInit(AsyncWebServer *server) {
+  server->on("/update-delta", HTTP_POST, [](AsyncWebServerRequest *request) {
+    // a POST without a file part never reaches otaDeltaUpload()
+    bool complete = otaDeltaComplete;
+    const char *error = otaDeltaError;
+    otaDeltaComplete = false;
+    otaDeltaError = nullptr;
+    if (error) {
+      request->send(500, "text/plain", error);
+      return;
+    }
+    if (!complete) {
+      request->send(400, "text/plain", "no delta image received");
+      return;
+    }
+    AsyncWebServerResponse *response = request->beginResponse(200, "text/plain", "OK");
+    response->addHeader("Connection", "close");
+    request->send(response);
+    Serial.println("Delta update complete - restarting");
+    otaModeRequestRestart();      // from loop(), after the response is sent
+  }, otaDeltaUpload);
+}
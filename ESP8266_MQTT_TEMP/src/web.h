@@ -0,0 +1,43 @@
+#ifndef __WEB_H__
+#define __WEB_H__
+
+#include <Arduino.h>
+#include <ESPAsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+
+//++++++++++++++++++++++
+// Web server endpoints
+// Responses are generated one line at a time by a LineSource into a
+// small fixed buffer and streamed as chunks, so no response is ever
+// built up in a String or on the heap.
+#define WEB_LINE_SIZE 160     // longest single line of a response
+
+// Live readings are pushed to browsers as Server-Sent Events on /events.
+// The async library queues each event per client and never blocks the
+// caller; a client whose own queue backs up is disconnected so it can
+// not hold heap, and the browser's EventSource reconnects on its own.
+// The other clients are left alone, except when a client has gone since
+// the last check: the library deletes it without telling us which, so
+// the others are closed once to list them again.
+#define SSE_MAX_CLIENTS 4     // concurrent /events connections
+#define SSE_MAX_BACKLOG 3     // queued events before a client is dropped
+#define SSE_RETRY_MS 5000     // browser reconnect delay after a drop
+
+// Writes the next line of a response into line and returns its length,
+// return 0 when the response is complete.
+typedef std::function<size_t(char *line, size_t len)> LineSource;
+
+//++++++++++++++++++++++
+// Forward function declarations
+AsyncWebServerResponse *beginLineResponse(AsyncWebServerRequest *request,
+                                          const char *contentType,
+                                          LineSource source);
+void webAssetsInit(AsyncWebServer *server);
+void webMetricsInit(AsyncWebServer *server);
+void webApiInit(AsyncWebServer *server);
+void webHistoryInit(AsyncWebServer *server);
+void webEventsInit(AsyncWebServer *server);
+void webEventsSendReadings();
+void webDeltaInit(AsyncWebServer *server);
+
+#endif  // __WEB_H__
@@ -0,0 +1,91 @@
+// Generated by tools/web_assets.py from the web/ directory - do not edit
+#ifndef __WEB_ASSETS_H__
+#define __WEB_ASSETS_H__
+
+#include <Arduino.h>
+
+struct WebAsset {
+  const char *path;           // URL the asset is served on
+  const char *contentType;
+  const char *etag;           // strong ETag of the gzip data
+  const uint8_t *data;        // gzip data in PROGMEM
+  size_t len;
+};
+
+// index.html: 2181 bytes, 1072 gzipped
+static const uint8_t index_html_gz[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x7d, 0x56, 0x7f, 0x6f, 0xdb, 0x36,
+  0x10, 0xfd, 0x3f, 0x9f, 0xe2, 0xa6, 0x16, 0x95, 0x3c, 0xc7, 0x92, 0x93, 0x60, 0x45, 0x66, 0xcb,
+  0x1a, 0xd6, 0xd4, 0xc5, 0x32, 0x34, 0x6b, 0x36, 0x07, 0x05, 0x86, 0x61, 0x28, 0x18, 0xf1, 0x24,
+  0x71, 0x93, 0x28, 0x81, 0xa4, 0xed, 0x66, 0x4b, 0xbe, 0xfb, 0x8e, 0xa4, 0x64, 0x3b, 0x3f, 0x30,
+  0x1b, 0x8e, 0xc4, 0xe3, 0xe3, 0xdd, 0xf1, 0xdd, 0x3b, 0x32, 0xe9, 0x37, 0xef, 0x3f, 0x5d, 0xdc,
+  0xfc, 0x7e, 0xbd, 0x84, 0xca, 0x34, 0x75, 0x76, 0x94, 0x0e, 0x0f, 0x64, 0x3c, 0x3b, 0x02, 0x48,
+  0x1b, 0x34, 0x0c, 0xf2, 0x8a, 0x29, 0x8d, 0x66, 0x11, 0xac, 0x4d, 0x31, 0x39, 0x0f, 0xf6, 0x13,
+  0x92, 0x35, 0xb8, 0x08, 0x36, 0x02, 0xb7, 0x5d, 0xab, 0x4c, 0x00, 0x79, 0x2b, 0x0d, 0x4a, 0x02,
+  0x6e, 0x05, 0x37, 0xd5, 0x82, 0xe3, 0x46, 0xe4, 0x38, 0x71, 0x83, 0x63, 0x10, 0x52, 0x18, 0xc1,
+  0xea, 0x89, 0xce, 0x59, 0x8d, 0x8b, 0x13, 0xef, 0xc6, 0x08, 0x53, 0x63, 0xb6, 0x5c, 0x5d, 0x9f,
+  0x9f, 0xbe, 0x7d, 0xfb, 0xe5, 0xea, 0xd7, 0x9b, 0x9b, 0x2f, 0x37, 0xcb, 0xab, 0xeb, 0x34, 0xf1,
+  0x13, 0x16, 0xa2, 0xcd, 0x9d, 0x7f, 0x03, 0xb8, 0x6d, 0xf9, 0x1d, 0xfc, 0x0b, 0xb7, 0x2c, 0xff,
+  0xbb, 0x54, 0xed, 0x5a, 0xf2, 0x49, 0xde, 0xd6, 0xad, 0x9a, 0x41, 0xd1, 0x2a, 0xd4, 0xa6, 0x54,
+  0x88, 0x72, 0x4e, 0x03, 0x69, 0x26, 0x05, 0x6b, 0x44, 0x7d, 0x37, 0x83, 0x1f, 0x15, 0xc5, 0x3c,
+  0x86, 0x15, 0x93, 0x7a, 0xb2, 0x42, 0x25, 0x8a, 0x39, 0xf4, 0x6b, 0x5e, 0x15, 0x05, 0x0d, 0x1a,
+  0xa6, 0x4a, 0x21, 0x67, 0x70, 0x82, 0xcd, 0x1c, 0x1e, 0x5c, 0x14, 0xc3, 0x6e, 0x6b, 0xb4, 0x61,
+  0x5a, 0xc5, 0x51, 0xd9, 0x10, 0x35, 0xeb, 0x34, 0xce, 0x60, 0x78, 0x9b, 0x1f, 0x64, 0x30, 0x03,
+  0x55, 0xde, 0xb2, 0x68, 0x7a, 0xec, 0xbe, 0xf1, 0xe9, 0x68, 0xe7, 0x85, 0xb6, 0x6c, 0x38, 0xb9,
+  0xe9, 0x18, 0xe7, 0x42, 0x96, 0x33, 0x98, 0xc6, 0x67, 0xd8, 0xd0, 0xdf, 0x73, 0x1b, 0xca, 0xe0,
+  0x57, 0x33, 0x61, 0xb5, 0x28, 0x29, 0xb6, 0x12, 0x65, 0x65, 0xf6, 0xeb, 0x68, 0xcd, 0xe1, 0x6c,
+  0x8d, 0xc5, 0x6e, 0x92, 0xd1, 0xdc, 0xa3, 0xf4, 0xbd, 0xf9, 0x15, 0x2b, 0x6d, 0xc2, 0x6e, 0xe3,
+  0x5a, 0xfc, 0x83, 0xb3, 0x21, 0x8a, 0x9d, 0x4e, 0x93, 0x9e, 0xc1, 0x34, 0xf1, 0x65, 0x4d, 0x2d,
+  0x8d, 0x8e, 0xda, 0xea, 0x04, 0x04, 0x5f, 0x04, 0x55, 0xab, 0x4d, 0xf0, 0x52, 0x11, 0xaa, 0x13,
+  0x07, 0xeb, 0x1c, 0x4a, 0xc8, 0xa2, 0x0d, 0xb2, 0x34, 0xe9, 0x7c, 0xe1, 0x2c, 0x49, 0xbe, 0x2a,
+  0xa9, 0x71, 0x7e, 0x53, 0xa3, 0xe8, 0x57, 0x65, 0x2b, 0x94, 0xba, 0x55, 0x54, 0xc1, 0xca, 0x0d,
+  0xdf, 0x70, 0x2c, 0xe7, 0x17, 0x8f, 0x87, 0x1f, 0xfc, 0x30, 0xb1, 0x2b, 0x12, 0x33, 0x88, 0xcd,
+  0x7a, 0x72, 0x15, 0xb6, 0xd1, 0x0c, 0x36, 0x9d, 0x0e, 0x7a, 0xa7, 0xdc, 0x6e, 0x5a, 0x77, 0x4c,
+  0x2e, 0x82, 0xb3, 0x20, 0xdb, 0x32, 0x12, 0x92, 0x2c, 0x6d, 0xd1, 0x89, 0x2d, 0x04, 0x49, 0x64,
+  0x81, 0x66, 0x4d, 0x57, 0x63, 0x1c, 0xc7, 0xe4, 0x90, 0xef, 0x5c, 0xef, 0x76, 0x9a, 0xec, 0xf2,
+  0x4d, 0xbb, 0xec, 0x73, 0x9e, 0xcf, 0x48, 0x57, 0xe4, 0xcf, 0x85, 0xda, 0xe4, 0x79, 0x90, 0x4d,
+  0x88, 0x26, 0x32, 0x64, 0xf0, 0x19, 0xde, 0xc8, 0x5b, 0xdd, 0xcd, 0xe1, 0xb7, 0xd5, 0xea, 0xf2,
+  0x10, 0xa6, 0xb4, 0x16, 0x07, 0x38, 0xfe, 0xae, 0x19, 0xb8, 0xf0, 0xfc, 0x50, 0x0d, 0xf6, 0xf4,
+  0x74, 0x59, 0xca, 0xa0, 0x52, 0x58, 0x2c, 0x82, 0x84, 0x75, 0x82, 0x4a, 0xc0, 0xcc, 0x9a, 0xf6,
+  0xe3, 0x9f, 0x69, 0xc2, 0x32, 0xb8, 0x87, 0x27, 0x10, 0xc7, 0x9b, 0xc5, 0xf8, 0x17, 0x0f, 0x72,
+  0xbc, 0x1c, 0x20, 0xa9, 0xef, 0x94, 0xc8, 0x09, 0xd5, 0xbf, 0x3c, 0x73, 0xb5, 0xee, 0x38, 0x33,
+  0x94, 0x49, 0x21, 0x54, 0xb3, 0x65, 0x0a, 0xc1, 0x1b, 0x2c, 0x6e, 0x48, 0x4e, 0xe7, 0x4a, 0x74,
+  0xc6, 0x53, 0xbe, 0x61, 0x0a, 0x6a, 0xa6, 0x0d, 0x2c, 0x60, 0x3a, 0x77, 0x96, 0x62, 0x2d, 0x73,
+  0x23, 0x5a, 0x09, 0xaf, 0x23, 0xc1, 0x47, 0x24, 0x2b, 0x85, 0x66, 0xad, 0x24, 0xf0, 0x36, 0x5f,
+  0x37, 0xd4, 0xdd, 0x71, 0x89, 0x66, 0x59, 0xa3, 0x7d, 0x7d, 0x77, 0x77, 0xc9, 0x2d, 0x68, 0xd0,
+  0xe1, 0x6e, 0xa9, 0xae, 0xda, 0x6d, 0xa4, 0x68, 0xb1, 0x4f, 0xdf, 0x45, 0x51, 0xed, 0x56, 0x53,
+  0x94, 0x30, 0x9c, 0xf7, 0x46, 0x5b, 0xbf, 0xc8, 0xce, 0x08, 0x17, 0x9c, 0x1e, 0x29, 0xa8, 0x38,
+  0x8f, 0x6b, 0x94, 0xa5, 0xa9, 0x68, 0x3c, 0x1e, 0xef, 0x3d, 0x78, 0x1f, 0x39, 0x21, 0x09, 0xf2,
+  0x87, 0xf8, 0x73, 0x0e, 0xfb, 0x4f, 0x92, 0x80, 0x5c, 0xd7, 0x35, 0xb0, 0xc2, 0xa0, 0xa2, 0x1e,
+  0x29, 0x98, 0xa8, 0x91, 0x53, 0xde, 0x8c, 0xef, 0x56, 0xbb, 0xe8, 0x63, 0x0a, 0x3f, 0xc8, 0x34,
+  0x84, 0x31, 0x45, 0x1c, 0x93, 0xc1, 0x4b, 0x93, 0x3b, 0x4b, 0x44, 0x11, 0x16, 0x0b, 0xef, 0xee,
+  0x07, 0x08, 0x27, 0x21, 0x50, 0xdb, 0xc7, 0xa6, 0xfd, 0x20, 0xbe, 0x22, 0x8f, 0x4e, 0x47, 0x23,
+  0x18, 0x1f, 0xc1, 0x93, 0x4f, 0xe8, 0x25, 0xf7, 0x3f, 0x1e, 0xc8, 0xf6, 0x2d, 0x7c, 0x0f, 0x09,
+  0x7c, 0x47, 0x80, 0xb3, 0xd3, 0xd1, 0x63, 0x87, 0x83, 0x03, 0xab, 0xd9, 0x1d, 0x39, 0x0f, 0xfd,
+  0xf3, 0x75, 0x14, 0xba, 0x56, 0x08, 0x47, 0xb1, 0x90, 0x12, 0xd5, 0x4f, 0x37, 0x57, 0x1f, 0x2d,
+  0x09, 0x76, 0x3b, 0xf7, 0xf7, 0xc3, 0x76, 0x1e, 0x37, 0x88, 0x6c, 0xa1, 0xd7, 0x10, 0x71, 0x4c,
+  0x67, 0xd4, 0x0b, 0xee, 0xc9, 0x2d, 0xc9, 0x9e, 0x9c, 0xda, 0x93, 0xe6, 0xc2, 0x1f, 0xdb, 0x8e,
+  0x5b, 0xb2, 0x1e, 0x64, 0x77, 0x00, 0xb7, 0xf2, 0x7f, 0x01, 0x6f, 0xcd, 0x03, 0xaa, 0xd7, 0xd1,
+  0x7b, 0x92, 0x5b, 0x2c, 0x49, 0x00, 0xfd, 0xf2, 0x5e, 0x1b, 0x68, 0xf2, 0x2a, 0x0a, 0x0f, 0xba,
+  0xc1, 0x7a, 0xab, 0x50, 0x46, 0x83, 0x6a, 0x9c, 0x60, 0x06, 0xb5, 0xa9, 0xf8, 0x2f, 0x4d, 0x26,
+  0x2b, 0xad, 0xa7, 0x30, 0xbd, 0x57, 0x05, 0xe5, 0x65, 0x0f, 0xaf, 0x67, 0x79, 0xe9, 0xd8, 0x9a,
+  0x0f, 0xb2, 0xb7, 0x87, 0xd7, 0x33, 0x54, 0xb8, 0xb1, 0x05, 0xd3, 0xf1, 0x06, 0x95, 0xb6, 0xaa,
+  0xa5, 0x4a, 0xc0, 0x04, 0xbc, 0x4d, 0x74, 0xfd, 0x50, 0x61, 0xcd, 0xee, 0x7a, 0xa3, 0x7b, 0x1f,
+  0xbc, 0xee, 0xfa, 0xc1, 0x5d, 0x55, 0x4f, 0x82, 0x3e, 0xf4, 0x7b, 0xb7, 0xa2, 0x45, 0x2b, 0x7b,
+  0x89, 0x5b, 0x58, 0x6e, 0x08, 0xbe, 0x6a, 0xd7, 0x2a, 0x47, 0x22, 0x02, 0xed, 0x88, 0x48, 0xf0,
+  0x40, 0xd4, 0x31, 0xdd, 0x13, 0x0e, 0xf1, 0x51, 0x68, 0x4a, 0x10, 0x15, 0x71, 0x4e, 0x0a, 0xa6,
+  0x93, 0x2e, 0x3c, 0xde, 0x75, 0x56, 0x84, 0x96, 0x23, 0xd7, 0x5e, 0x3f, 0xaf, 0x3e, 0xfd, 0x12,
+  0x77, 0xf6, 0x66, 0x8e, 0x30, 0xa6, 0x16, 0x67, 0x23, 0x47, 0x96, 0x77, 0x47, 0xd7, 0xf5, 0x25,
+  0x6d, 0x53, 0x6d, 0x58, 0xbd, 0x27, 0xee, 0x11, 0x6f, 0x74, 0x5c, 0x3d, 0x23, 0xc4, 0x15, 0x90,
+  0x44, 0xeb, 0x8f, 0x0c, 0xee, 0x76, 0x7d, 0xc5, 0x4c, 0x15, 0xbb, 0xab, 0x2e, 0x8a, 0xf6, 0x95,
+  0x25, 0x62, 0x2c, 0x78, 0x44, 0x9a, 0x3e, 0x99, 0x4e, 0xa7, 0x4e, 0xc5, 0xa0, 0x81, 0x95, 0xad,
+  0xd5, 0xfb, 0xd0, 0xe3, 0x0f, 0xc7, 0x7e, 0x76, 0xee, 0xaf, 0xa1, 0xfe, 0xd8, 0x49, 0x13, 0x7f,
+  0x2c, 0xd3, 0xfd, 0xe2, 0xfe, 0xdb, 0xf8, 0x0f, 0x78, 0x7b, 0x26, 0xdd, 0x85, 0x08, 0x00, 0x00,
+};
+
+static const WebAsset webAssets[] = {
+  { "/", "text/html", "\"93920e376a774c78\"", index_html_gz, sizeof(index_html_gz) },
+};
+#define WEB_ASSET_COUNT (sizeof(webAssets) / sizeof(webAssets[0]))
+
+#endif  // __WEB_ASSETS_H__
@@ -0,0 +1,289 @@
+#include "wifiap.h"
+#include "rtcmem.h"
+#include "WiFi_Init.h"
+
+extern Config config;  // declare the external configuration struct
+extern Status status;  // declare the external status struct
+
+static_assert(RTC_WIFI + RTC_BLOCKS(WifiApCache) <= RTC_WIFI_END,
+              "WifiApCache does not fit its RTC memory slot");
+
+WifiStats wifiStats;
+
+static WifiConnect connectLog[WIFI_LOG_SIZE];
+static int logNext = 0;
+
+// the join in progress
+static uint8_t joinCredential = 0;
+static uint8_t joinType = WIFI_JOIN_SSID;
+static unsigned long joinStart = 0;
+
+static unsigned long roamCheck = 0;
+static bool roamScanning = false;
+static bool roamJoining = false;
+
+// the link lost while awake
+static bool lost = false;
+static unsigned long lostSince = 0;
+static bool rejoining = false;        // the running scan is for a rejoin
+static bool rejoinWait = false;       // a join failed, backing off
+static unsigned long rejoinFailed = 0;
+static unsigned long rejoinDelay = WIFI_REJOIN_MIN_MS;
+
+/*-------------------------------------------------------------------------
+ * Function to return a configured network, false if the slot is empty
+ *-------------------------------------------------------------------------*/
+static bool credential(uint8_t i, const char *&ssid, const char *&pw) {
+  switch (i) {
+    case 0: ssid = config.ssid; pw = config.pw; break;
+    case 1: ssid = config.ssid1; pw = config.pw1; break;
+    case 2: ssid = config.ssid2; pw = config.pw2; break;
+    default: return false;
+  }
+  return ssid[0] != '\0';
+}
+
+/*-------------------------------------------------------------------------
+ * Function to find the strongest AP of a configured network in the
+ * results of a completed scan
+ * - skip excludes the AP currently joined, nullptr for none
+ * - returns the index of the result, -1 if none
+ *-------------------------------------------------------------------------*/
+static int bestAp(int results, const uint8_t *skip, uint8_t &cred) {
+  int best = -1;
+  for (int r = 0; r < results; r++) {
+    if (skip && memcmp(WiFi.BSSID(r), skip, 6) == 0) continue;
+    for (uint8_t c = 0; c < WIFI_AP_CREDENTIALS; c++) {
+      const char *ssid, *pw;
+      if (!credential(c, ssid, pw) || !WiFi.SSID(r).equals(ssid)) continue;
+      if (best < 0 || WiFi.RSSI(r) > WiFi.RSSI(best)) {
+        best = r;
+        cred = c;
+      }
+    }
+  }
+  return best;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to start joining one AP of a scan result
+ *-------------------------------------------------------------------------*/
+static void joinResult(int r, uint8_t cred, uint8_t join) {
+  const char *ssid, *pw;
+  credential(cred, ssid, pw);
+  Serial.printf("...joining %s %s ch %i RSSI %i...\r\n", ssid, WiFi.BSSIDstr(r).c_str(),
+                WiFi.channel(r), WiFi.RSSI(r));
+  joinCredential = cred;
+  joinType = join;
+  joinStart = millis();
+  WiFi.begin(ssid, pw, WiFi.channel(r), WiFi.BSSID(r));
+}
+
+/*-------------------------------------------------------------------------
+ * Function to join config.ssid by name, any AP (hidden SSID)
+ *-------------------------------------------------------------------------*/
+static void joinSsid() {
+  Serial.println("...no configured network in the scan...");
+  joinCredential = 0;
+  joinType = WIFI_JOIN_SSID;
+  joinStart = millis();
+  WiFi.begin(config.ssid, config.pw);
+}
+
+static void cacheDrop() {
+  WifiApCache cache = { 0, { 0 }, 0, 0 };
+  ESP.rtcUserMemoryWrite(RTC_WIFI, (uint32_t *)&cache, sizeof(cache));
+}
+
+// the core has given up on the join, it stays so until the next begin()
+static bool joinFailed(wl_status_t st) {
+  return st == WL_NO_SSID_AVAIL || st == WL_CONNECT_FAILED || st == WL_WRONG_PASSWORD;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to give up the AP and scan for another in the background
+ * - stops the core retrying the pinned BSSID, wifiApLoop() joins the
+ *   result
+ *-------------------------------------------------------------------------*/
+static void rejoinScan() {
+  cacheDrop();
+  WiFi.disconnect();
+  wifiStats.scans++;
+  WiFi.scanNetworks(true);            // async, checked with scanComplete()
+  roamScanning = true;
+  roamJoining = false;
+  rejoining = true;
+  lost = false;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to start joining the best AP
+ * - useCache joins the AP from the last wake without a scan
+ * - otherwise scans and joins the strongest AP of any configured
+ *   network, or config.ssid by name when none is heard (hidden SSID)
+ * - returns true when the join used the cache
+ *-------------------------------------------------------------------------*/
+bool wifiApBegin(bool useCache) {
+  WifiApCache cache;
+  ESP.rtcUserMemoryRead(RTC_WIFI, (uint32_t *)&cache, sizeof(cache));
+  const char *ssid, *pw;
+  if (useCache && cache.magic == RTC_WIFI_MAGIC && credential(cache.credential, ssid, pw)) {
+    joinCredential = cache.credential;
+    joinType = WIFI_JOIN_CACHED;
+    joinStart = millis();
+    WiFi.begin(ssid, pw, cache.channel, cache.bssid);
+    return true;
+  }
+
+  wifiStats.scans++;
+  int results = WiFi.scanNetworks();
+  uint8_t cred = 0;
+  int r = bestAp(results, nullptr, cred);
+  if (r >= 0) joinResult(r, cred, WIFI_JOIN_SCAN);
+  else joinSsid();
+  WiFi.scanDelete();
+  return false;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to fall back from a cached join that did not connect
+ * - returns true once the scan based join was started
+ *-------------------------------------------------------------------------*/
+bool wifiApFastJoin() {
+  if (joinType != WIFI_JOIN_CACHED || millis() - joinStart < WIFI_FAST_TIMEOUT_MS) {
+    return false;
+  }
+  Serial.println("...cached AP did not answer - scanning...");
+  cacheDrop();
+  wifiApBegin(false);
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to record a completed join and cache the AP for the next wake
+ *-------------------------------------------------------------------------*/
+void wifiApConnected() {
+  WifiConnect &c = connectLog[logNext];
+  logNext = (logNext + 1) % WIFI_LOG_SIZE;
+  c.ms = millis();
+  c.durationMs = millis() - joinStart;
+  memcpy(c.bssid, WiFi.BSSID(), 6);
+  c.rssi = WiFi.RSSI();
+  c.channel = WiFi.channel();
+  c.credential = joinCredential;
+  c.join = joinType;
+  wifiStats.connects++;
+  status.ip = WiFi.localIP();         // a roam may hand out a new lease
+  Serial.printf("...WiFi %s AP %s ch %u RSSI %i in %lu ms...\r\n", wifiJoinName(c.join),
+                WiFi.BSSIDstr().c_str(), c.channel, c.rssi, (unsigned long)c.durationMs);
+
+  WifiApCache cache;
+  cache.magic = RTC_WIFI_MAGIC;
+  memcpy(cache.bssid, c.bssid, 6);
+  cache.channel = c.channel;
+  cache.credential = c.credential;
+  ESP.rtcUserMemoryWrite(RTC_WIFI, (uint32_t *)&cache, sizeof(cache));
+  roamCheck = millis();
+}
+
+/*-------------------------------------------------------------------------
+ * Function to roam to a stronger AP and rejoin a lost link while awake
+ * - checks the RSSI every WIFI_ROAM_CHECK_MS and scans in the
+ *   background when it is below config.wifiRoamRssi
+ * - scans in the background when the link is down for WIFI_LOST_MS and
+ *   after a join that failed, never blocking the loop
+ * - a join fails on the core's status or after WIFI_ROAM_TIMEOUT_MS,
+ *   the scan after it waits rejoinDelay, doubled on every failure
+ *-------------------------------------------------------------------------*/
+void wifiApLoop() {
+  if (roamJoining) {
+    wl_status_t st = WiFi.status();
+    if (st == WL_CONNECTED) {
+      roamJoining = false;
+      rejoinDelay = WIFI_REJOIN_MIN_MS;
+      if (joinType == WIFI_JOIN_ROAM) wifiStats.roams++;
+      wifiApConnected();
+    }
+    else if (joinFailed(st) || millis() - joinStart > WIFI_ROAM_TIMEOUT_MS) {
+      roamJoining = false;
+      rejoinWait = true;
+      rejoinFailed = millis();
+      WiFi.disconnect();              // no retries by the core meanwhile
+      Serial.printf("...join failed (%s) - scanning again in %lu ms...\r\n",
+                    wl_status_to_string(st), rejoinDelay);
+    }
+    return;
+  }
+
+  if (rejoinWait) {
+    if (millis() - rejoinFailed < rejoinDelay) return;
+    rejoinWait = false;
+    rejoinDelay = min(2 * rejoinDelay, WIFI_REJOIN_MAX_MS);   // back off
+    rejoinScan();
+    return;
+  }
+
+  if (roamScanning) {
+    int results = WiFi.scanComplete();
+    if (results == WIFI_SCAN_RUNNING) return;
+    roamScanning = false;
+    uint8_t cred = 0;
+    if (rejoining) {
+      rejoining = false;
+      int r = results > 0 ? bestAp(results, nullptr, cred) : -1;
+      if (r >= 0) joinResult(r, cred, WIFI_JOIN_SCAN);
+      else joinSsid();
+      roamJoining = true;
+    }
+    else {
+      int r = results > 0 ? bestAp(results, WiFi.BSSID(), cred) : -1;
+      if (r >= 0 && WiFi.RSSI(r) >= WiFi.RSSI() + config.wifiRoamMargin) {
+        joinResult(r, cred, WIFI_JOIN_ROAM);
+        roamJoining = true;
+      }
+    }
+    WiFi.scanDelete();
+    return;
+  }
+
+  if (WiFi.status() != WL_CONNECTED) {
+    if (!lost) {
+      lost = true;
+      lostSince = millis();
+    }
+    else if (millis() - lostSince > WIFI_LOST_MS) {
+      Serial.println("...WiFi lost - giving up the AP and scanning...");
+      rejoinScan();
+    }
+    return;
+  }
+  lost = false;
+
+  if (millis() - roamCheck < WIFI_ROAM_CHECK_MS) return;
+  roamCheck = millis();
+  if (WiFi.RSSI() >= config.wifiRoamRssi) return;
+
+  Serial.printf("...RSSI %i below %i - scanning for a better AP...\r\n",
+                WiFi.RSSI(), config.wifiRoamRssi);
+  wifiStats.scans++;
+  WiFi.scanNetworks(true);            // async, checked with scanComplete()
+  roamScanning = true;
+}
+
+/*-------------------------------------------------------------------------
+ * Function to return a connect from the log, 0 = most recent
+ * - returns nullptr past the connects recorded
+ *-------------------------------------------------------------------------*/
+const WifiConnect *wifiApLog(int i) {
+  if (i >= WIFI_LOG_SIZE || (uint32_t)i >= wifiStats.connects) return nullptr;
+  return &connectLog[(logNext - 1 - i + 2 * WIFI_LOG_SIZE) % WIFI_LOG_SIZE];
+}
+
+const char *wifiJoinName(uint8_t join) {
+  switch (join) {
+    case WIFI_JOIN_CACHED: return "cached";
+    case WIFI_JOIN_SCAN: return "scan";
+    case WIFI_JOIN_ROAM: return "roam";
+    default: return "ssid";
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef __WIFIAP_H__
+#define __WIFIAP_H__
+
+#include <Arduino.h>
+
+//++++++++++++++++++++++
+// Access point selection and roaming
+// Up to WIFI_AP_CREDENTIALS networks are configured (config.ssid and the
+// alternates ssid1, ssid2).  A scan ranks every AP that carries one of
+// them by RSSI and the strongest is joined by BSSID and channel.  The
+// choice is cached in RTC memory so a deep sleep wake joins the same AP
+// directly without scanning; if that fails within WIFI_FAST_TIMEOUT_MS
+// the cache is dropped and a scan picks again.  Always-on nodes scan in
+// the background when the RSSI drops below config.wifiRoamRssi and move
+// to an AP at least config.wifiRoamMargin dB stronger.  A join is pinned
+// to one BSSID, so when the link is down for WIFI_LOST_MS the cache is
+// dropped and a background scan picks again.  A join ends as soon as the
+// core reports a failure, or after WIFI_ROAM_TIMEOUT_MS, and the next scan
+// waits a delay doubling from WIFI_REJOIN_MIN_MS up to WIFI_REJOIN_MAX_MS.
+// The last
+// WIFI_LOG_SIZE connects are kept with the AP and RSSI chosen.
+#define WIFI_AP_CREDENTIALS 3
+#define WIFI_FAST_TIMEOUT_MS 5000UL   // cached AP join before a scan
+#define WIFI_ROAM_CHECK_MS 60000UL    // RSSI check interval while awake
+#define WIFI_ROAM_TIMEOUT_MS 10000UL  // join of a roam or rejoin
+#define WIFI_LOST_MS 5000UL           // link down before the AP is given up
+#define WIFI_REJOIN_MIN_MS 5000UL     // first wait between rejoin scans
+#define WIFI_REJOIN_MAX_MS 300000UL   // longest wait between rejoin scans
+#define WIFI_LOG_SIZE 4
+#define RTC_WIFI_MAGIC 0x57494631UL   // "WIF1"
+
+enum WifiJoin { WIFI_JOIN_CACHED, WIFI_JOIN_SCAN, WIFI_JOIN_SSID, WIFI_JOIN_ROAM };
+
+struct WifiApCache {                  // kept in RTC memory
+  uint32_t magic;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t credential;                 // index of the ssid/pw used
+};
+
+struct WifiConnect {                  // one connect in the log
+  uint32_t ms;                        // millis() at the connect
+  uint32_t durationMs;                // begin to connected
+  uint8_t bssid[6];
+  int8_t rssi;
+  uint8_t channel;
+  uint8_t credential;
+  uint8_t join;                       // WifiJoin
+};
+
+struct WifiStats {
+  uint32_t connects;
+  uint32_t scans;
+  uint32_t roams;
+};
+
+extern WifiStats wifiStats;
+
+//++++++++++++++++++++++
+// Forward function declarations
+bool wifiApBegin(bool useCache);
+bool wifiApFastJoin();
+void wifiApConnected();
+void wifiApLoop();
+const WifiConnect *wifiApLog(int i);
+const char *wifiJoinName(uint8_t join);
+
+#endif  // __WIFIAP_H__
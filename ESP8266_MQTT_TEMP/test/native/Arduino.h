@@ -0,0 +1,56 @@
+#ifndef __NATIVE_ARDUINO_H__
+#define __NATIVE_ARDUINO_H__
+
+//++++++++++++++++++++++
+// Host stand-in for the parts of the Arduino core the tested modules use
+// Only for the [env:native] unit tests - see platformio.ini.  The clock
+// is nativeMillis, set by the test, and RTC user memory is a plain array.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <algorithm>
+
+typedef uint8_t byte;
+using std::min;
+using std::max;
+
+inline unsigned long nativeMillis = 0;
+inline unsigned long millis() { return nativeMillis; }
+inline unsigned long micros() { return nativeMillis * 1000; }
+inline long random(long howbig) { return howbig > 0 ? rand() % howbig : 0; }
+
+class NativeSerial {
+ public:
+  int printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, format);
+    int n = verbose ? vprintf(format, args) : 0;
+    va_end(args);
+    return n;
+  }
+  size_t print(const char *s) { return verbose ? ::printf("%s", s) : 0; }
+  size_t println(const char *s) { return verbose ? ::printf("%s\n", s) : 0; }
+  bool verbose = false;               // module logging to stdout
+};
+inline NativeSerial Serial;
+
+class NativeEsp {
+ public:
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size) {
+    if (offset * 4 + size > sizeof(rtc)) return false;
+    memcpy(data, (uint8_t *)rtc + offset * 4, size);
+    return true;
+  }
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size) {
+    if (offset * 4 + size > sizeof(rtc)) return false;
+    memcpy((uint8_t *)rtc + offset * 4, data, size);
+    return true;
+  }
+  uint32_t rtc[128];                  // zeroed like a power on
+};
+inline NativeEsp ESP;
+
+#endif  // __NATIVE_ARDUINO_H__
@@ -0,0 +1,22 @@
+#ifndef __NATIVE_ESP8266WIFI_H__
+#define __NATIVE_ESP8266WIFI_H__
+
+//++++++++++++++++++++++
+// Host stand-in for the WiFi types WiFi_Init.h declares structs with
+#include <Arduino.h>
+
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : addr(a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+  operator uint32_t() const { return addr; }
+ private:
+  uint32_t addr = 0;
+};
+
+typedef enum {
+  WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL, WL_SCAN_COMPLETED, WL_CONNECTED,
+  WL_CONNECT_FAILED, WL_CONNECTION_LOST, WL_WRONG_PASSWORD, WL_DISCONNECTED
+} wl_status_t;
+
+#endif  // __NATIVE_ESP8266WIFI_H__
@@ -0,0 +1,73 @@
+#ifndef __NATIVE_LITTLEFS_H__
+#define __NATIVE_LITTLEFS_H__
+
+//++++++++++++++++++++++
+// Host stand-in for LittleFS - files are byte vectors in a map, and an
+// open File keeps a pointer to its vector, as LittleFS sees the writes
+// of other handles
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File {
+ public:
+  File() {}
+  File(std::vector<uint8_t> *data, size_t pos) : data(data), pos(pos) {}
+  explicit operator bool() const { return data != nullptr; }
+  size_t read(uint8_t *buf, size_t len) {
+    if (!data) return 0;
+    size_t n = std::min(len, data->size() - std::min(pos, data->size()));
+    memcpy(buf, data->data() + pos, n);
+    pos += n;
+    return n;
+  }
+  size_t write(const uint8_t *buf, size_t len) {
+    if (!data) return 0;
+    if (data->size() < pos + len) data->resize(pos + len);
+    memcpy(data->data() + pos, buf, len);
+    pos += len;
+    return len;
+  }
+  bool seek(uint32_t offset, SeekMode mode = SeekSet) {
+    size_t base = mode == SeekSet ? 0 : mode == SeekCur ? pos : size();
+    if (!data || base + offset > data->size()) return false;
+    pos = base + offset;
+    return true;
+  }
+  bool truncate(uint32_t size) {
+    if (!data) return false;
+    data->resize(size);
+    return true;
+  }
+  size_t size() const { return data ? data->size() : 0; }
+  size_t position() const { return pos; }
+  void close() { data = nullptr; }
+
+ private:
+  std::vector<uint8_t> *data = nullptr;
+  size_t pos = 0;
+};
+
+class NativeFS {
+ public:
+  bool begin() { return true; }
+  File open(const char *path, const char *mode) {
+    auto it = files.find(path);
+    if (mode[0] == 'r' && it == files.end()) return File();
+    std::vector<uint8_t> &data = files[path];
+    if (mode[0] == 'w') data.clear();
+    return File(&data, mode[0] == 'a' ? data.size() : 0);
+  }
+  bool exists(const char *path) { return files.count(path) != 0; }
+  bool remove(const char *path) { return files.erase(path) != 0; }
+  void format() { files.clear(); }     // for the tests - start empty
+
+ private:
+  std::map<std::string, std::vector<uint8_t>> files;
+};
+inline NativeFS LittleFS;
+
+#endif  // __NATIVE_LITTLEFS_H__
@@ -0,0 +1,4 @@
+// Host tests need no credentials - a real src/WiFiSecrets.h is found
+// first when there is one, WiFi_Init.h supplies the other defaults.
+#define SECRET_SSID ""
+#define SECRET_PASS ""
@@ -0,0 +1,160 @@
+// Adaptive sample interval on simulated DS18B20 traces - see src/adaptive.h
+#include <unity.h>
+#include <math.h>
+#include "adaptive.cpp"
+
+Config config;
+
+static int16_t raw[ADAPT_CHANNELS];
+static unsigned int errors[ADAPT_CHANNELS];
+static uint8_t resolution[ADAPT_CHANNELS];
+
+//++++++++++++++++++++++
+// Sensor stand-in: the true temperature plus up to NOISE_C of noise,
+// rounded to the resolution like the DS18B20 does.  The flat traces sit
+// on a step boundary, so every reading is a coin toss between two steps.
+#define NOISE_C 0.03
+
+static int16_t quantise(double degC, int bits) {
+  double step = 1 << (12 - bits);                 // raw 1/16 degC per step
+  degC += NOISE_C * (2.0 * rand() / RAND_MAX - 1.0);
+  return (int16_t)(floor(degC * 16 / step + 0.5) * step);
+}
+
+typedef double (*Trace)(double minutes);
+
+static double flat12(double minutes) { return 21.53125; }   // 344.5 / 16
+static double flat9(double minutes) { return 21.75; }       // 43.5 / 2
+static double ramp(double minutes) { return 15.0 + minutes; }    // 1 degC/min
+static double rampHold(double minutes) { return minutes < 20 ? 15.0 + minutes : 35.0; }
+
+// run `minutes` awake at the adaptive interval, returns the longest and
+// shortest intervals chosen after the first `settle` minutes
+static void runAwake(Trace trace, int bits, double minutes,
+                     double settle, unsigned long &longest, unsigned long &shortest) {
+  for (int i = 0; i < ADAPT_CHANNELS; i++) resolution[i] = bits;
+  unsigned long start = nativeMillis;
+  unsigned long interval = config.adaptAwakeMaxMs;
+  longest = 0;
+  shortest = ~0UL;
+  while (nativeMillis - start < minutes * 60000) {
+    nativeMillis += interval;
+    double t = (nativeMillis - start) / 60000.0;
+    raw[0] = quantise(trace(t), bits);
+    adaptiveUpdate(raw, errors, resolution, 1);
+    interval = adaptiveAwakeMs();
+    if (t < settle) continue;
+    if (interval > longest) longest = interval;
+    if (interval < shortest) shortest = interval;
+  }
+}
+
+void setUp(void) {
+  config.adaptThreshold = 10;
+  config.adaptAwakeMinMs = 2000;
+  config.adaptAwakeMaxMs = 30000;
+  config.adaptSleepMinSec = 60;
+  config.adaptSleepMaxSec = 1800;
+  memset(errors, 0, sizeof(errors));
+  memset(ESP.rtc, 0, sizeof(ESP.rtc));
+  nativeMillis = 0;
+  srand(7);
+  adaptiveInit(true);
+}
+
+void tearDown(void) {}
+
+// a steady temperature dithering by a step must not shorten the interval
+void test_flat_12bit_dither(void) {
+  unsigned long longest, shortest;
+  runAwake(flat12, 12, 120, 0, longest, shortest);
+  TEST_ASSERT_EQUAL(30000, shortest);
+  TEST_ASSERT_EQUAL(0, adaptiveActivity());
+}
+
+void test_flat_9bit_dither(void) {
+  unsigned long longest, shortest;
+  runAwake(flat9, 9, 120, 0, longest, shortest);
+  TEST_ASSERT_EQUAL(30000, shortest);
+  TEST_ASSERT_EQUAL(0, adaptiveActivity());
+}
+
+// a real change is followed - 1 degC/min is ten times the threshold
+void test_ramp_shortens_interval(void) {
+  unsigned long longest, shortest;
+  runAwake(ramp, 12, 30, 15, longest, shortest);
+  TEST_ASSERT_LESS_THAN(30000 / 8, longest);
+  TEST_ASSERT_INT_WITHIN(10, 100, adaptiveActivity());
+}
+
+void test_ramp_9bit(void) {
+  unsigned long longest, shortest;
+  runAwake(ramp, 9, 30, 15, longest, shortest);
+  TEST_ASSERT_LESS_THAN(30000 / 4, longest);
+}
+
+// and once it stops the interval goes back to the maximum
+void test_ramp_then_flat_recovers(void) {
+  unsigned long longest, shortest;
+  runAwake(rampHold, 12, 80, 70, longest, shortest);
+  TEST_ASSERT_EQUAL(30000, shortest);
+}
+
+// the rate waits for a full window however often the node samples
+void test_no_rate_before_window(void) {
+  resolution[0] = 12;
+  for (int i = 0; i < 100; i++) {
+    nativeMillis += 2000;
+    raw[0] = 21 * 16 + i * 4;               // 0.25 degC per sample
+    adaptiveUpdate(raw, errors, resolution, 1);
+    if (nativeMillis < ADAPT_WINDOW_MS) TEST_ASSERT_EQUAL(0, adaptiveActivity());
+  }
+  TEST_ASSERT_GREATER_THAN(0, adaptiveActivity());
+}
+
+// a failed read at the window end starts the channel over, no spike
+void test_failed_read_restarts_window(void) {
+  resolution[0] = 12;
+  raw[0] = 21 * 16;
+  adaptiveUpdate(raw, errors, resolution, 1);
+  nativeMillis += ADAPT_WINDOW_MS;
+  raw[0] = TEMP_RAW_INVALID;
+  errors[0]++;
+  adaptiveUpdate(raw, errors, resolution, 1);
+  TEST_ASSERT_EQUAL(0, adaptiveActivity());
+
+  nativeMillis += ADAPT_WINDOW_MS;
+  raw[0] = 21 * 16;
+  adaptiveUpdate(raw, errors, resolution, 1);
+  nativeMillis += ADAPT_WINDOW_MS;
+  adaptiveUpdate(raw, errors, resolution, 1);
+  TEST_ASSERT_EQUAL(0, adaptiveActivity());
+}
+
+// deep sleep: the window spans the sleep and the state RTC memory
+void test_sleep_flat_stays_at_max(void) {
+  resolution[0] = 9;
+  for (int wake = 0; wake < 20; wake++) {
+    nativeMillis = 0;
+    adaptiveInit(false);
+    nativeMillis = 300;
+    raw[0] = quantise(flat9(0), 9);
+    adaptiveUpdate(raw, errors, resolution, 1);
+    uint64_t sleepUs = adaptiveSleepUs();
+    TEST_ASSERT_EQUAL(1800000000ULL, sleepUs);
+    adaptiveSleep(sleepUs);
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_flat_12bit_dither);
+  RUN_TEST(test_flat_9bit_dither);
+  RUN_TEST(test_ramp_shortens_interval);
+  RUN_TEST(test_ramp_9bit);
+  RUN_TEST(test_ramp_then_flat_recovers);
+  RUN_TEST(test_no_rate_before_window);
+  RUN_TEST(test_failed_read_restarts_window);
+  RUN_TEST(test_sleep_flat_stays_at_max);
+  return UNITY_END();
+}
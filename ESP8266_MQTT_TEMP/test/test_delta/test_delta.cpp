@@ -0,0 +1,223 @@
+// Streaming delta decoder - see src/delta.h
+#include <unity.h>
+#include <vector>
+#include "delta.cpp"
+
+static std::vector<uint8_t> base, target, out;
+static uint32_t baseReadMax;             // largest single base read
+
+static bool testBegin(const DeltaHeader &header) {
+  return header.baseSize == base.size();
+}
+
+static bool testReadBase(uint32_t offset, uint8_t *buf, size_t len) {
+  if (offset + len > base.size()) return false;
+  if (len > baseReadMax) baseReadMax = len;
+  memcpy(buf, base.data() + offset, len);
+  return true;
+}
+
+static bool testWrite(const uint8_t *buf, size_t len) {
+  out.insert(out.end(), buf, buf + len);
+  return true;
+}
+
+//++++++++++++++++++++++
+// Delta builder, the same format as tools/ota_image.py writes
+static void putVarint(std::vector<uint8_t> &v, uint32_t n) {
+  while (n >= 0x80) {
+    v.push_back((n & 0x7F) | 0x80);
+    n >>= 7;
+  }
+  v.push_back(n);
+}
+
+static std::vector<uint8_t> header(uint32_t targetSize) {
+  DeltaHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, DELTA_MAGIC, 4);
+  h.baseSize = base.size();
+  h.targetSize = targetSize;
+  const uint8_t *p = (const uint8_t *)&h;
+  return std::vector<uint8_t>(p, p + sizeof(h));
+}
+
+static void copyOp(std::vector<uint8_t> &d, uint32_t offset, uint32_t len) {
+  d.push_back(DELTA_OP_COPY);
+  putVarint(d, offset);
+  putVarint(d, len);
+}
+
+static void addOp(std::vector<uint8_t> &d, const uint8_t *data, uint32_t len) {
+  d.push_back(DELTA_OP_ADD);
+  putVarint(d, len);
+  d.insert(d.end(), data, data + len);
+}
+
+// target = base[100..1100) + 50 new + base[2000..3000) + 7 new + base[0..300)
+static std::vector<uint8_t> makeDelta() {
+  uint8_t fresh[57];
+  for (size_t i = 0; i < sizeof(fresh); i++) fresh[i] = 0xA0 + i;
+  target.clear();
+  target.insert(target.end(), base.begin() + 100, base.begin() + 1100);
+  target.insert(target.end(), fresh, fresh + 50);
+  target.insert(target.end(), base.begin() + 2000, base.begin() + 3000);
+  target.insert(target.end(), fresh + 50, fresh + 57);
+  target.insert(target.end(), base.begin(), base.begin() + 300);
+
+  std::vector<uint8_t> d = header(target.size());
+  copyOp(d, 100, 1000);
+  addOp(d, fresh, 50);
+  copyOp(d, 2000, 1000);
+  addOp(d, fresh + 50, 7);
+  copyOp(d, 0, 300);
+  d.push_back(DELTA_OP_END);
+  return d;
+}
+
+static DeltaDecoder decoder;
+
+static bool feed(const std::vector<uint8_t> &d) {
+  deltaInit(decoder, testBegin, testReadBase, testWrite);
+  return deltaFeed(decoder, d.data(), d.size());
+}
+
+void setUp(void) {
+  base.resize(4096);
+  srand(1);
+  for (uint8_t &b : base) b = rand();
+  out.clear();
+  baseReadMax = 0;
+}
+
+void tearDown(void) {}
+
+void test_whole_upload(void) {
+  TEST_ASSERT_TRUE(feed(makeDelta()));
+  TEST_ASSERT_TRUE(deltaDone(decoder));
+  TEST_ASSERT_EQUAL(target.size(), out.size());
+  TEST_ASSERT_EQUAL_MEMORY(target.data(), out.data(), target.size());
+  TEST_ASSERT_LESS_OR_EQUAL(DELTA_COPY_CHUNK, baseReadMax);
+}
+
+void test_one_byte_at_a_time(void) {
+  std::vector<uint8_t> d = makeDelta();
+  deltaInit(decoder, testBegin, testReadBase, testWrite);
+  for (uint8_t b : d) TEST_ASSERT_TRUE(deltaFeed(decoder, &b, 1));
+  TEST_ASSERT_TRUE(deltaDone(decoder));
+  TEST_ASSERT_EQUAL_MEMORY(target.data(), out.data(), target.size());
+}
+
+// the upload arrives in pieces of any size, split anywhere
+void test_random_chunk_splits(void) {
+  std::vector<uint8_t> d = makeDelta();
+  srand(42);
+  for (int run = 0; run < 200; run++) {
+    out.clear();
+    deltaInit(decoder, testBegin, testReadBase, testWrite);
+    size_t pos = 0;
+    while (pos < d.size()) {
+      size_t n = 1 + rand() % 97;
+      if (n > d.size() - pos) n = d.size() - pos;
+      TEST_ASSERT_TRUE(deltaFeed(decoder, d.data() + pos, n));
+      pos += n;
+    }
+    TEST_ASSERT_TRUE(deltaDone(decoder));
+    TEST_ASSERT_EQUAL(target.size(), out.size());
+    TEST_ASSERT_EQUAL_MEMORY(target.data(), out.data(), target.size());
+  }
+}
+
+void test_truncated_is_not_done(void) {
+  std::vector<uint8_t> d = makeDelta();
+  d.resize(d.size() - 20);
+  TEST_ASSERT_TRUE(feed(d));
+  TEST_ASSERT_FALSE(deltaDone(decoder));
+}
+
+void test_not_a_delta(void) {
+  std::vector<uint8_t> d = makeDelta();
+  d[0] = 'X';
+  TEST_ASSERT_FALSE(feed(d));
+  TEST_ASSERT_EQUAL_STRING("not a delta image", decoder.error);
+}
+
+void test_copy_offset_outside_base(void) {
+  std::vector<uint8_t> d = header(10);
+  copyOp(d, base.size() + 1, 1);
+  TEST_ASSERT_FALSE(feed(d));
+  TEST_ASSERT_EQUAL_STRING("COPY outside the base image", decoder.error);
+  TEST_ASSERT_EQUAL(0, out.size());
+}
+
+void test_copy_end_outside_base(void) {
+  std::vector<uint8_t> d = header(100);
+  copyOp(d, base.size() - 10, 11);
+  TEST_ASSERT_FALSE(feed(d));
+  TEST_ASSERT_EQUAL_STRING("COPY outside the base image", decoder.error);
+}
+
+void test_copy_wraps_offset(void) {
+  std::vector<uint8_t> d = header(100);
+  copyOp(d, 16, 0xFFFFFFF8);            // offset + length wraps 32 bits
+  TEST_ASSERT_FALSE(feed(d));
+  TEST_ASSERT_EQUAL_STRING("COPY outside the base image", decoder.error);
+}
+
+void test_copy_past_target(void) {
+  std::vector<uint8_t> d = header(100);
+  copyOp(d, 0, 101);
+  TEST_ASSERT_FALSE(feed(d));
+  TEST_ASSERT_EQUAL_STRING("delta too long", decoder.error);
+  TEST_ASSERT_EQUAL(0, out.size());
+}
+
+void test_add_past_target(void) {
+  uint8_t fresh[8] = {0};
+  std::vector<uint8_t> d = header(10);
+  addOp(d, fresh, 4);
+  addOp(d, fresh, 7);
+  TEST_ASSERT_FALSE(feed(d));
+  TEST_ASSERT_EQUAL_STRING("delta too long", decoder.error);
+  TEST_ASSERT_EQUAL(4, out.size());
+}
+
+void test_data_after_end(void) {
+  std::vector<uint8_t> d = makeDelta();
+  d.push_back(DELTA_OP_END);
+  TEST_ASSERT_FALSE(feed(d));
+  TEST_ASSERT_EQUAL_STRING("data after END", decoder.error);
+}
+
+void test_unknown_op(void) {
+  std::vector<uint8_t> d = header(10);
+  d.push_back(0x7F);
+  TEST_ASSERT_FALSE(feed(d));
+  TEST_ASSERT_EQUAL_STRING("unknown op", decoder.error);
+}
+
+void test_bad_varint(void) {
+  std::vector<uint8_t> d = header(10);
+  d.push_back(DELTA_OP_ADD);
+  for (int i = 0; i < 6; i++) d.push_back(0xFF);
+  TEST_ASSERT_FALSE(feed(d));
+  TEST_ASSERT_EQUAL_STRING("bad varint", decoder.error);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_whole_upload);
+  RUN_TEST(test_one_byte_at_a_time);
+  RUN_TEST(test_random_chunk_splits);
+  RUN_TEST(test_truncated_is_not_done);
+  RUN_TEST(test_not_a_delta);
+  RUN_TEST(test_copy_offset_outside_base);
+  RUN_TEST(test_copy_end_outside_base);
+  RUN_TEST(test_copy_wraps_offset);
+  RUN_TEST(test_copy_past_target);
+  RUN_TEST(test_add_past_target);
+  RUN_TEST(test_data_after_end);
+  RUN_TEST(test_unknown_op);
+  RUN_TEST(test_bad_varint);
+  return UNITY_END();
+}
@@ -0,0 +1,130 @@
+// Fixed-point temperature conversion and formatting - see src/fixedpoint.h
+#include <unity.h>
+#include <math.h>
+#include <chrono>
+#include "fixedpoint.cpp"
+
+#define RAW_MIN (-55 * 16)                // DS18B20 range, 1/16 degC
+#define RAW_MAX (125 * 16)
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// every reading is exact in a double: raw * 6.25 and raw * 11.25 are
+// multiples of 1/4, and llround() rounds half away from zero
+void test_centi_c_exact(void) {
+  for (int raw = RAW_MIN; raw <= RAW_MAX; raw++) {
+    TEST_ASSERT_EQUAL(llround(raw * 6.25), tempCentiC(raw));
+  }
+}
+
+void test_centi_f_exact(void) {
+  for (int raw = RAW_MIN; raw <= RAW_MAX; raw++) {
+    TEST_ASSERT_EQUAL(llround(raw * 11.25 + 3200), tempCentiF(raw));
+  }
+}
+
+void test_known_values(void) {
+  char buf[12];
+  struct { int16_t raw; const char *c, *f; } known[] = {
+    { RAW_MIN, "-55.00", "-67.00" },
+    { -10 * 16, "-10.00", "14.00" },
+    { -8, "-0.50", "31.10" },
+    { -1, "-0.06", "31.89" },        // -0.0625 and 31.8875, half away
+    { 0, "0.00", "32.00" },
+    { 1, "0.06", "32.11" },          // 32.1125
+    { 344, "21.50", "70.70" },
+    { 4 * 16 + 9, "4.56", "40.21" }, // 4.5625 and 40.2125
+    { RAW_MAX, "125.00", "257.00" },
+  };
+  for (auto &k : known) {
+    formatTempC(buf, sizeof(buf), k.raw);
+    TEST_ASSERT_EQUAL_STRING(k.c, buf);
+    formatTempF(buf, sizeof(buf), k.raw);
+    TEST_ASSERT_EQUAL_STRING(k.f, buf);
+  }
+}
+
+// -40 is the same on both scales, and sub-degree negatives keep the sign
+void test_negative_formatting(void) {
+  char buf[16];
+  formatTempF(buf, sizeof(buf), -40 * 16);
+  TEST_ASSERT_EQUAL_STRING("-40.00", buf);
+  formatTempC(buf, sizeof(buf), -40 * 16);
+  TEST_ASSERT_EQUAL_STRING("-40.00", buf);
+  formatTempF(buf, sizeof(buf), -285);      // -17.8125 degC = -0.0625 degF
+  TEST_ASSERT_EQUAL_STRING("-0.06", buf);
+  formatFixed(buf, sizeof(buf), -5, 3);
+  TEST_ASSERT_EQUAL_STRING("-0.005", buf);
+  formatFixed(buf, sizeof(buf), INT32_MIN, 2);
+  TEST_ASSERT_EQUAL_STRING("-21474836.48", buf);
+}
+
+// a published value parses back to the reading it came from - a step is
+// 6.25 centi degC or 11.25 centi degF, far more than the rounding
+void test_round_trip(void) {
+  char buf[12];
+  for (int raw = RAW_MIN; raw <= RAW_MAX; raw++) {
+    formatTempC(buf, sizeof(buf), raw);
+    TEST_ASSERT_EQUAL(raw, lround(strtod(buf, NULL) * 16));
+    formatTempF(buf, sizeof(buf), raw);
+    TEST_ASSERT_EQUAL(raw, lround((strtod(buf, NULL) - 32) * 16 * 5 / 9));
+  }
+}
+
+//++++++++++++++++++++++
+// Benchmark: the fixed-point path against the float one it replaced.  On
+// the host the FPU flatters the float path - on the ESP8266 every float
+// operation is a library call - so only the result is printed, and the
+// two must agree apart from halves, which printf rounds to even.
+#define BENCH_ROUNDS 200
+
+static double nsPerReading(std::chrono::steady_clock::duration d) {
+  double readings = (double)BENCH_ROUNDS * (RAW_MAX - RAW_MIN + 1);
+  return std::chrono::duration<double, std::nano>(d).count() / readings;
+}
+
+void test_benchmark_fixed_vs_float(void) {
+  char fixed[12], flt[12];
+  unsigned long sum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int n = 0; n < BENCH_ROUNDS; n++) {
+    for (int raw = RAW_MIN; raw <= RAW_MAX; raw++) {
+      sum += formatTempC(fixed, sizeof(fixed), raw);
+      sum += formatTempF(fixed, sizeof(fixed), raw);
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (int n = 0; n < BENCH_ROUNDS; n++) {
+    for (int raw = RAW_MIN; raw <= RAW_MAX; raw++) {
+      float c = raw * 0.0625f;
+      sum += snprintf(flt, sizeof(flt), "%.2f", c);
+      sum += snprintf(flt, sizeof(flt), "%.2f", c * 1.8f + 32.0f);
+    }
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  printf("fixed point %.1f ns, float %.1f ns per reading (C and F) [%lu]\n",
+         nsPerReading(t1 - t0), nsPerReading(t2 - t1), sum);
+
+  int differ = 0;
+  for (int raw = RAW_MIN; raw <= RAW_MAX; raw++) {
+    formatTempC(fixed, sizeof(fixed), raw);
+    snprintf(flt, sizeof(flt), "%.2f", raw * 0.0625f);
+    if (strcmp(fixed, flt) == 0) continue;
+    TEST_ASSERT_EQUAL(2, abs(raw * 25) % 4);  // x.xx5 exactly - a half
+    differ++;
+  }
+  TEST_ASSERT_LESS_THAN((RAW_MAX - RAW_MIN) / 2, differ);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_centi_c_exact);
+  RUN_TEST(test_centi_f_exact);
+  RUN_TEST(test_known_values);
+  RUN_TEST(test_negative_formatting);
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_benchmark_fixed_vs_float);
+  return UNITY_END();
+}
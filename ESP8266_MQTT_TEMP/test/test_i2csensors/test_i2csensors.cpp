@@ -0,0 +1,315 @@
+// I2C sensor drivers on a mock bus - see src/i2csensors.h
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "fixedpoint.cpp"
+#include "i2csensors.cpp"
+
+//++++++++++++++++++++++
+// Mock bus: the same four calls as WireBus over a table of devices.  A
+// device answers register reads from regs[] and plain reads from data,
+// and keeps the last bytes written to it.
+struct MockDevice {
+  bool present = false;
+  bool nack = false;                    // present but refuses transfers
+  uint8_t regs[256] = {};
+  std::vector<uint8_t> data;
+  std::vector<uint8_t> written;
+};
+
+struct MockBus {
+  MockDevice dev[128];
+
+  bool probe(uint8_t addr) {
+    return dev[addr].present;
+  }
+  bool write(uint8_t addr, const uint8_t *data, size_t len) {
+    MockDevice &d = dev[addr];
+    if (!d.present || d.nack) return false;
+    d.written.assign(data, data + len);
+    return true;
+  }
+  bool read(uint8_t addr, uint8_t *data, size_t len) {
+    MockDevice &d = dev[addr];
+    if (!d.present || d.nack || d.data.size() < len) return false;
+    memcpy(data, d.data.data(), len);
+    return true;
+  }
+  bool writeRead(uint8_t addr, const uint8_t *out, size_t outLen,
+                 uint8_t *in, size_t inLen) {
+    MockDevice &d = dev[addr];
+    if (!d.present || d.nack || outLen != 1 || out[0] + inLen > 256) return false;
+    memcpy(in, d.regs + out[0], inLen);
+    return true;
+  }
+};
+
+static MockBus bus;
+
+// SHT3x answer: two big endian words, each with its CRC
+static void shtData(uint16_t t, uint16_t rh) {
+  uint8_t d[6] = { (uint8_t)(t >> 8), (uint8_t)t, 0, (uint8_t)(rh >> 8), (uint8_t)rh, 0 };
+  d[2] = sensirionCrc(d, 2);
+  d[5] = sensirionCrc(d + 3, 2);
+  bus.dev[Sht3x::ADDR].data.assign(d, d + 6);
+}
+
+// BMP280 with the datasheet's worked example calibration
+static const int16_t bmpCal[12] = { 27504, 26435, -1000, (int16_t)36477, -10685, 3024,
+                                    2855, 140, -7, 15500, -14600, 6000 };
+
+static void bmpData(int32_t adcP, int32_t adcT) {
+  uint8_t *r = bus.dev[Bmp280::ADDR].regs;
+  r[0xF7] = adcP >> 12;
+  r[0xF8] = adcP >> 4;
+  r[0xF9] = adcP << 4;
+  r[0xFA] = adcT >> 12;
+  r[0xFB] = adcT >> 4;
+  r[0xFC] = adcT << 4;
+}
+
+static void adsData(int16_t raw) {
+  bus.dev[Ads1115::ADDR].regs[0x00] = raw >> 8;
+  bus.dev[Ads1115::ADDR].regs[0x01] = raw;
+}
+
+static std::string text(const Reading &r) {
+  char buf[16];
+  readingFormat(buf, sizeof(buf), r);
+  return buf;
+}
+
+void setUp(void) {
+  bus = MockBus();
+  bus.dev[Sht3x::ADDR].present = true;
+  bus.dev[Ads1115::ADDR].present = true;
+  MockDevice &bmp = bus.dev[Bmp280::ADDR];
+  bmp.present = true;
+  bmp.regs[0xD0] = 0x58;
+  for (int i = 0; i < 12; i++) {
+    bmp.regs[0x88 + 2 * i] = (uint16_t)bmpCal[i];
+    bmp.regs[0x89 + 2 * i] = (uint16_t)bmpCal[i] >> 8;
+  }
+  bmpData(415148, 519888);
+  shtData(0x6666, 0x8000);
+  adsData(0x4000);
+}
+
+void tearDown(void) {}
+
+void test_sensirion_crc(void) {
+  const uint8_t word[] = { 0xBE, 0xEF };  // the datasheet example
+  TEST_ASSERT_EQUAL(0x92, sensirionCrc(word, 2));
+}
+
+void test_sht3x(void) {
+  Sht3x sht;
+  Reading r[2];
+  TEST_ASSERT_TRUE(sht.begin(bus));
+  TEST_ASSERT_EQUAL(16, sht.start(bus));
+  const uint8_t cmd[] = { 0x24, 0x00 };
+  TEST_ASSERT_EQUAL(2, bus.dev[Sht3x::ADDR].written.size());
+  TEST_ASSERT_EQUAL_MEMORY(cmd, bus.dev[Sht3x::ADDR].written.data(), 2);
+  TEST_ASSERT_TRUE(sht.read(bus, r));
+  TEST_ASSERT_INT_WITHIN(1, 2500, r[0].value);    // -45 + 175 * 0.4
+  TEST_ASSERT_INT_WITHIN(1, 5000, r[1].value);
+  TEST_ASSERT_EQUAL_STRING("sht3x_temp", r[0].name);
+  TEST_ASSERT_EQUAL_STRING("%", r[1].unit);
+}
+
+void test_sht3x_extremes(void) {
+  Sht3x sht;
+  Reading r[2];
+  shtData(0, 0);
+  TEST_ASSERT_TRUE(sht.read(bus, r));
+  TEST_ASSERT_EQUAL(-4500, r[0].value);
+  TEST_ASSERT_EQUAL_STRING("-45.00", text(r[0]).c_str());
+  TEST_ASSERT_EQUAL(0, r[1].value);
+  shtData(0xFFFF, 0xFFFF);
+  TEST_ASSERT_TRUE(sht.read(bus, r));
+  TEST_ASSERT_EQUAL(13000, r[0].value);
+  TEST_ASSERT_EQUAL(10000, r[1].value);
+}
+
+void test_sht3x_bad_crc(void) {
+  Sht3x sht;
+  Reading r[2];
+  bus.dev[Sht3x::ADDR].data[5] ^= 1;      // humidity word corrupted
+  TEST_ASSERT_FALSE(sht.read(bus, r));
+  TEST_ASSERT_FALSE(r[0].valid);
+  TEST_ASSERT_FALSE(r[1].valid);
+  TEST_ASSERT_EQUAL_STRING("", text(r[0]).c_str());
+}
+
+void test_sht3x_absent(void) {
+  Sht3x sht;
+  bus.dev[Sht3x::ADDR].present = false;
+  TEST_ASSERT_FALSE(sht.begin(bus));
+  TEST_ASSERT_EQUAL(0, sht.start(bus));
+}
+
+void test_bmp280_datasheet_example(void) {
+  Bmp280 bmp;
+  Reading r[2];
+  TEST_ASSERT_TRUE(bmp.begin(bus));
+  TEST_ASSERT_EQUAL(7, bmp.start(bus));
+  TEST_ASSERT_EQUAL(0xF4, bus.dev[Bmp280::ADDR].written[0]);
+  TEST_ASSERT_TRUE(bmp.read(bus, r));
+  TEST_ASSERT_EQUAL(2508, r[0].value);              // 25.08 degC
+  TEST_ASSERT_EQUAL(100653, r[1].value);            // 100653 Pa
+  TEST_ASSERT_EQUAL_STRING("25.08", text(r[0]).c_str());
+  TEST_ASSERT_EQUAL_STRING("1006.53", text(r[1]).c_str());
+  TEST_ASSERT_EQUAL_STRING("hPa", r[1].unit);
+}
+
+void test_bme280_chip_id(void) {
+  Bmp280 bmp;
+  bus.dev[Bmp280::ADDR].regs[0xD0] = 0x60;
+  TEST_ASSERT_TRUE(bmp.begin(bus));
+}
+
+void test_bmp280_wrong_chip(void) {
+  Bmp280 bmp;
+  bus.dev[Bmp280::ADDR].regs[0xD0] = 0x55;   // not a BMP280
+  TEST_ASSERT_FALSE(bmp.begin(bus));
+}
+
+// dig_P1 = 0 would divide by zero - the reading is marked invalid
+void test_bmp280_zero_calibration(void) {
+  Bmp280 bmp;
+  Reading r[2];
+  bus.dev[Bmp280::ADDR].regs[0x8E] = 0;
+  bus.dev[Bmp280::ADDR].regs[0x8F] = 0;
+  TEST_ASSERT_TRUE(bmp.begin(bus));
+  TEST_ASSERT_FALSE(bmp.read(bus, r));
+  TEST_ASSERT_FALSE(r[1].valid);
+}
+
+void test_bmp280_nack(void) {
+  Bmp280 bmp;
+  Reading r[2];
+  TEST_ASSERT_TRUE(bmp.begin(bus));
+  bus.dev[Bmp280::ADDR].nack = true;
+  TEST_ASSERT_EQUAL(0, bmp.start(bus));
+  TEST_ASSERT_FALSE(bmp.read(bus, r));
+  TEST_ASSERT_FALSE(r[0].valid);
+}
+
+// a failed transfer converts the zeroed buffer, never stale stack bytes
+void test_failed_transfers(void) {
+  Sht3x sht;
+  Ads1115 ads;
+  Reading r[2];
+  bus.dev[Sht3x::ADDR].nack = true;
+  bus.dev[Ads1115::ADDR].nack = true;
+  TEST_ASSERT_FALSE(sht.read(bus, r));
+  TEST_ASSERT_FALSE(r[0].valid);
+  TEST_ASSERT_FALSE(r[1].valid);
+  TEST_ASSERT_EQUAL(0, r[1].value);
+  TEST_ASSERT_FALSE(ads.read(bus, r));
+  TEST_ASSERT_FALSE(r[0].valid);
+  TEST_ASSERT_EQUAL(0, r[0].value);
+}
+
+void test_ads1115(void) {
+  Ads1115 ads;
+  Reading r[1];
+  TEST_ASSERT_TRUE(ads.begin(bus));
+  TEST_ASSERT_EQUAL(9, ads.start(bus));
+  const uint8_t config[] = { 0x01, 0xC3, 0x83 };
+  TEST_ASSERT_EQUAL_MEMORY(config, bus.dev[Ads1115::ADDR].written.data(), 3);
+  TEST_ASSERT_TRUE(ads.read(bus, r));
+  TEST_ASSERT_EQUAL_STRING("2.048", text(r[0]).c_str());
+  adsData(-8);                            // -1 mV
+  TEST_ASSERT_TRUE(ads.read(bus, r));
+  TEST_ASSERT_EQUAL_STRING("-0.001", text(r[0]).c_str());
+  adsData(INT16_MAX);
+  TEST_ASSERT_TRUE(ads.read(bus, r));
+  TEST_ASSERT_EQUAL_STRING("4.095", text(r[0]).c_str());
+}
+
+//++++++++++++++++++++++
+// The registry over all three drivers
+typedef SensorSet<MockBus, Sht3x, Bmp280, Ads1115> Sensors;
+
+void test_set_all_present(void) {
+  Sensors sensors(bus);
+  Reading table[Sensors::CHANNELS];
+  TEST_ASSERT_EQUAL(5, Sensors::CHANNELS);
+  TEST_ASSERT_EQUAL(3, sensors.begin());
+  TEST_ASSERT_EQUAL(16, sensors.start());          // the slowest driver
+  TEST_ASSERT_EQUAL(5, sensors.read(table));
+  TEST_ASSERT_EQUAL_STRING("sht3x_temp", table[0].name);
+  TEST_ASSERT_EQUAL_STRING("sht3x_rh", table[1].name);
+  TEST_ASSERT_EQUAL_STRING("bmp280_temp", table[2].name);
+  TEST_ASSERT_EQUAL_STRING("bmp280_press", table[3].name);
+  TEST_ASSERT_EQUAL_STRING("ads1115_ain0", table[4].name);
+  for (const Reading &r : table) TEST_ASSERT_TRUE(r.valid);
+}
+
+void test_set_absent_driver_skipped(void) {
+  Sensors sensors(bus);
+  Reading table[Sensors::CHANNELS];
+  bus.dev[Bmp280::ADDR].present = false;
+  TEST_ASSERT_EQUAL(2, sensors.begin());
+  TEST_ASSERT_EQUAL(16, sensors.start());
+  TEST_ASSERT_EQUAL(3, sensors.read(table));
+  TEST_ASSERT_EQUAL_STRING("ads1115_ain0", table[2].name);
+}
+
+void test_set_none_present(void) {
+  Sensors sensors(bus);
+  Reading table[Sensors::CHANNELS];
+  for (MockDevice &d : bus.dev) d.present = false;
+  TEST_ASSERT_EQUAL(0, sensors.begin());
+  TEST_ASSERT_EQUAL(0, sensors.start());
+  TEST_ASSERT_EQUAL(0, sensors.read(table));
+}
+
+// a driver whose conversion did not start reads as invalid, in place
+void test_set_failed_start(void) {
+  Sensors sensors(bus);
+  Reading table[Sensors::CHANNELS];
+  sensors.begin();
+  bus.dev[Sht3x::ADDR].nack = true;
+  TEST_ASSERT_EQUAL(9, sensors.start());
+  bus.dev[Sht3x::ADDR].nack = false;
+  TEST_ASSERT_EQUAL(5, sensors.read(table));
+  TEST_ASSERT_FALSE(table[0].valid);
+  TEST_ASSERT_FALSE(table[1].valid);
+  TEST_ASSERT_TRUE(table[2].valid);
+  TEST_ASSERT_TRUE(table[4].valid);
+}
+
+// read() without a new start() does not return stale values as valid
+void test_set_read_needs_start(void) {
+  Sensors sensors(bus);
+  Reading table[Sensors::CHANNELS];
+  sensors.begin();
+  sensors.start();
+  sensors.read(table);
+  TEST_ASSERT_EQUAL(5, sensors.read(table));
+  for (const Reading &r : table) TEST_ASSERT_FALSE(r.valid);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sensirion_crc);
+  RUN_TEST(test_sht3x);
+  RUN_TEST(test_sht3x_extremes);
+  RUN_TEST(test_sht3x_bad_crc);
+  RUN_TEST(test_sht3x_absent);
+  RUN_TEST(test_bmp280_datasheet_example);
+  RUN_TEST(test_bme280_chip_id);
+  RUN_TEST(test_bmp280_wrong_chip);
+  RUN_TEST(test_bmp280_zero_calibration);
+  RUN_TEST(test_bmp280_nack);
+  RUN_TEST(test_failed_transfers);
+  RUN_TEST(test_ads1115);
+  RUN_TEST(test_set_all_present);
+  RUN_TEST(test_set_absent_driver_skipped);
+  RUN_TEST(test_set_none_present);
+  RUN_TEST(test_set_failed_start);
+  RUN_TEST(test_set_read_needs_start);
+  return UNITY_END();
+}
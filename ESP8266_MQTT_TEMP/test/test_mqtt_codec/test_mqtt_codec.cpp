@@ -0,0 +1,127 @@
+// MQTT packet encoder and streaming decoder - see src/mqtt_codec.h
+#include <unity.h>
+#include <vector>
+#include "mqtt_codec.cpp"
+
+struct Packet {
+  uint8_t header;
+  std::vector<uint8_t> body;
+};
+
+static std::vector<Packet> packets;
+static MqttDecoder decoder;
+
+static void collect(uint8_t header, const uint8_t *body, size_t len) {
+  packets.push_back({ header, std::vector<uint8_t>(body, body + len) });
+}
+
+static bool decode(const std::vector<uint8_t> &data) {
+  return mqttDecode(decoder, data.data(), data.size(), collect);
+}
+
+void setUp(void) {
+  packets.clear();
+  mqttDecoderReset(decoder);
+}
+
+void tearDown(void) {}
+
+void test_publish_round_trip(void) {
+  uint8_t buf[MQTT_TX_MAX];
+  const char payload[] = "{\"t\":\"21.50\"}";
+  size_t n = mqttEncodePublish(buf, sizeof(buf), "node/out", (const uint8_t *)payload,
+                               strlen(payload), 1, false, true, 0x1234);
+  TEST_ASSERT_EQUAL(2 + 2 + 8 + 2 + strlen(payload), n);
+  TEST_ASSERT_EQUAL(MQTT_PUBLISH | 0x08 | 0x02, buf[0]);    // DUP, QoS 1
+  TEST_ASSERT_TRUE(mqttDecode(decoder, buf, n, collect));
+  TEST_ASSERT_EQUAL(1, packets.size());
+  const std::vector<uint8_t> &body = packets[0].body;
+  TEST_ASSERT_EQUAL(8, body[1]);
+  TEST_ASSERT_EQUAL_MEMORY("node/out", &body[2], 8);
+  TEST_ASSERT_EQUAL(0x12, body[10]);
+  TEST_ASSERT_EQUAL(0x34, body[11]);
+  TEST_ASSERT_EQUAL_MEMORY(payload, &body[12], strlen(payload));
+}
+
+// a body of 200 bytes needs a two byte length
+void test_two_byte_length(void) {
+  uint8_t buf[MQTT_TX_MAX], payload[200] = {0};
+  size_t n = mqttEncodePublish(buf, sizeof(buf), "t", payload, sizeof(payload),
+                               0, false, false, 0);
+  TEST_ASSERT_EQUAL(1 + 2 + 3 + 200, n);
+  TEST_ASSERT_EQUAL(0x80 | (203 & 0x7F), buf[1]);
+  TEST_ASSERT_EQUAL(203 >> 7, buf[2]);
+  TEST_ASSERT_TRUE(mqttDecode(decoder, buf, n, collect));
+  TEST_ASSERT_EQUAL(203, packets[0].body.size());
+}
+
+void test_byte_at_a_time(void) {
+  uint8_t buf[64];
+  size_t n = mqttEncodeAck(buf, sizeof(buf), MQTT_PUBACK, 7);
+  n += mqttEncodeEmpty(buf + n, sizeof(buf) - n, MQTT_PINGRESP);
+  for (size_t i = 0; i < n; i++) TEST_ASSERT_TRUE(mqttDecode(decoder, buf + i, 1, collect));
+  TEST_ASSERT_EQUAL(2, packets.size());
+  TEST_ASSERT_EQUAL(MQTT_PUBACK, packets[0].header);
+  TEST_ASSERT_EQUAL(7, packets[0].body[1]);
+  TEST_ASSERT_EQUAL(MQTT_PINGRESP, packets[1].header);
+  TEST_ASSERT_EQUAL(0, packets[1].body.size());
+}
+
+void test_encode_does_not_fit(void) {
+  uint8_t buf[16];
+  MqttConnectOpts opts = {};
+  opts.clientId = "a-client-id-longer-than-the-buffer";
+  TEST_ASSERT_EQUAL(0, mqttEncodeConnect(buf, sizeof(buf), opts));
+}
+
+// larger than MQTT_RX_MAX: read past and dropped, the next one framed
+void test_oversize_packet_skipped(void) {
+  std::vector<uint8_t> d = { MQTT_PUBLISH, 0x80 | 0x58, 0x04 };   // 600
+  d.resize(d.size() + 600, 0xAA);
+  d.insert(d.end(), { MQTT_PINGRESP, 0x00 });
+  TEST_ASSERT_TRUE(decode(d));
+  TEST_ASSERT_EQUAL(1, packets.size());
+  TEST_ASSERT_EQUAL(MQTT_PINGRESP, packets[0].header);
+}
+
+// four length bytes is the 3.1.1 maximum and still frames
+void test_four_byte_length(void) {
+  std::vector<uint8_t> d = { MQTT_PUBLISH, 0x80, 0x80, 0x80, 0x00 };  // 0, padded
+  d.insert(d.end(), { MQTT_PINGRESP, 0x00 });
+  TEST_ASSERT_TRUE(decode(d));
+  TEST_ASSERT_EQUAL(2, packets.size());
+  TEST_ASSERT_EQUAL(0, packets[0].body.size());
+}
+
+// a fifth length byte is a protocol error, whatever is fed after it
+void test_five_byte_length_rejected(void) {
+  std::vector<uint8_t> d = { MQTT_PUBLISH, 0xFF, 0xFF, 0xFF, 0xFF, 0x01 };
+  d.insert(d.end(), { MQTT_PINGRESP, 0x00 });
+  TEST_ASSERT_FALSE(decode(d));
+  TEST_ASSERT_EQUAL(0, packets.size());
+  TEST_ASSERT_EQUAL(0, decoder.state);                  // reset
+
+  packets.clear();
+  TEST_ASSERT_TRUE(decode({ MQTT_PINGRESP, 0x00 }));     // a new connection
+  TEST_ASSERT_EQUAL(1, packets.size());
+}
+
+void test_endless_length_split(void) {
+  std::vector<uint8_t> d = { MQTT_PUBLISH, 0x80, 0x80 };
+  TEST_ASSERT_TRUE(decode(d));
+  TEST_ASSERT_TRUE(decode({ 0x80 }));
+  TEST_ASSERT_FALSE(decode({ 0x80 }));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_publish_round_trip);
+  RUN_TEST(test_two_byte_length);
+  RUN_TEST(test_byte_at_a_time);
+  RUN_TEST(test_encode_does_not_fit);
+  RUN_TEST(test_oversize_packet_skipped);
+  RUN_TEST(test_four_byte_length);
+  RUN_TEST(test_five_byte_length_rejected);
+  RUN_TEST(test_endless_length_split);
+  return UNITY_END();
+}
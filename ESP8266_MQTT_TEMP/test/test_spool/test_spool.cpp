@@ -0,0 +1,166 @@
+// Store-and-forward spool replay - see src/spool.h
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "spool.cpp"
+
+Config config;
+
+//++++++++++++++++++++++
+// Broker stand-in: takes payloads until it has accepted `capacity` of
+// them, then refuses like a full QoS 1 window or a dropped connection
+static std::vector<std::string> received;
+static size_t capacity;
+
+static bool brokerSend(const char *msg) {
+  if (received.size() >= capacity) return false;
+  received.push_back(msg);
+  return true;
+}
+
+static void pushN(int from, int count, uint32_t epoch) {
+  char msg[40];
+  for (int i = from; i < from + count; i++) {
+    snprintf(msg, sizeof(msg), "{\"node\":{\"n\":\"%i\"}}", i);
+    TEST_ASSERT_TRUE(spoolPush(msg, epoch ? epoch + i : 0));
+  }
+}
+
+// the spooled number i out of a replayed payload
+static int number(const std::string &msg) {
+  return atoi(msg.c_str() + msg.find("\"n\":\"") + 5);
+}
+
+// a new wake: RAM state gone, the flash queue kept
+static void wake() {
+  nativeMillis = 100000;
+  spoolInit();
+}
+
+void setUp(void) {
+  LittleFS.format();
+  config.spoolBatch = 3;
+  config.spoolInterval = 1000;
+  received.clear();
+  capacity = 1000;
+  wake();
+}
+
+void tearDown(void) {}
+
+void test_replay_in_order_with_timestamp(void) {
+  pushN(0, 2, 1700000000);
+  TEST_ASSERT_EQUAL(2, spoolReplay(brokerSend, true));
+  TEST_ASSERT_EQUAL(2, received.size());
+  TEST_ASSERT_EQUAL_STRING("{\"node\":{\"n\":\"0\",\"ts\":\"1700000000\"}}", received[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("{\"node\":{\"n\":\"1\",\"ts\":\"1700000001\"}}", received[1].c_str());
+  TEST_ASSERT_FALSE(spoolPending());
+  TEST_ASSERT_FALSE(LittleFS.exists(SPOOL_FILE));   // emptied queue removed
+}
+
+void test_no_timestamp_without_clock(void) {
+  pushN(0, 1, 0);
+  spoolReplay(brokerSend, true);
+  TEST_ASSERT_EQUAL_STRING("{\"node\":{\"n\":\"0\"}}", received[0].c_str());
+}
+
+// always-on node: the first batch waits a random part of the interval,
+// then at most spoolBatch payloads per spoolInterval
+void test_rate_limited_replay(void) {
+  pushN(0, 10, 0);
+  TEST_ASSERT_EQUAL(0, spoolReplay(brokerSend, false));
+
+  unsigned long lastBatch = 0;
+  int batches = 0;
+  for (int t = 0; t < 10000 && spoolPending(); t += 10) {
+    nativeMillis += 10;
+    int sent = spoolReplay(brokerSend, false);
+    if (!sent) continue;
+    TEST_ASSERT_LESS_OR_EQUAL(config.spoolBatch, sent);
+    if (batches++) TEST_ASSERT_GREATER_OR_EQUAL(config.spoolInterval, nativeMillis - lastBatch);
+    lastBatch = nativeMillis;
+  }
+  TEST_ASSERT_EQUAL(4, batches);
+  TEST_ASSERT_EQUAL(10, received.size());
+  for (int i = 0; i < 10; i++) TEST_ASSERT_EQUAL(i, number(received[i]));
+}
+
+// deep sleep node: one batch at once, the passes after it rate limited
+void test_one_immediate_batch_per_wake(void) {
+  pushN(0, 10, 0);
+  TEST_ASSERT_EQUAL(3, spoolReplay(brokerSend, true));
+  for (int pass = 0; pass < 50; pass++) {
+    nativeMillis += 10;
+    spoolReplay(brokerSend, true);
+  }
+  TEST_ASSERT_EQUAL(3, received.size());    // 500 ms - nothing more
+  nativeMillis += 600;
+  TEST_ASSERT_EQUAL(3, spoolReplay(brokerSend, true));
+
+  wake();                                   // next wake - at once again
+  TEST_ASSERT_EQUAL(3, spoolReplay(brokerSend, true));
+  TEST_ASSERT_EQUAL(9, received.size());
+}
+
+// the broker stops taking payloads mid batch - nothing lost or repeated
+void test_broker_gone_mid_batch(void) {
+  pushN(0, 5, 0);
+  capacity = 2;
+  TEST_ASSERT_EQUAL(2, spoolReplay(brokerSend, true));
+  TEST_ASSERT_TRUE(spoolPending());
+
+  capacity = 1000;
+  nativeMillis += config.spoolInterval;
+  TEST_ASSERT_EQUAL(3, spoolReplay(brokerSend, true));
+  TEST_ASSERT_EQUAL(5, received.size());
+  for (int i = 0; i < 5; i++) TEST_ASSERT_EQUAL(i, number(received[i]));
+}
+
+// the replay position survives a deep sleep or a reset
+void test_resume_after_wake(void) {
+  pushN(0, 7, 0);
+  TEST_ASSERT_EQUAL(3, spoolReplay(brokerSend, true));
+  wake();
+  TEST_ASSERT_TRUE(spoolPending());
+  while (spoolPending()) {
+    nativeMillis += config.spoolInterval;
+    spoolReplay(brokerSend, true);
+  }
+  TEST_ASSERT_EQUAL(7, received.size());
+  for (int i = 0; i < 7; i++) TEST_ASSERT_EQUAL(i, number(received[i]));
+}
+
+// new payloads go to the back of the queue while it is replayed
+void test_push_during_replay(void) {
+  pushN(0, 4, 0);
+  spoolReplay(brokerSend, true);
+  pushN(4, 2, 0);
+  while (spoolPending()) {
+    nativeMillis += config.spoolInterval;
+    spoolReplay(brokerSend, false);
+  }
+  TEST_ASSERT_EQUAL(6, received.size());
+  for (int i = 0; i < 6; i++) TEST_ASSERT_EQUAL(i, number(received[i]));
+}
+
+void test_full_spool_drops(void) {
+  std::string big(SPOOL_MSG_MAX, 'x');
+  int pushed = 0;
+  while (spoolPush(big.c_str(), 0)) pushed++;
+  TEST_ASSERT_EQUAL(SPOOL_MAX_BYTES / (SPOOL_MSG_MAX + 6), pushed);
+  TEST_ASSERT_EQUAL(1, spoolStats.dropped);
+  TEST_ASSERT_LESS_OR_EQUAL(SPOOL_MAX_BYTES, spoolBacklog());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_replay_in_order_with_timestamp);
+  RUN_TEST(test_no_timestamp_without_clock);
+  RUN_TEST(test_rate_limited_replay);
+  RUN_TEST(test_one_immediate_batch_per_wake);
+  RUN_TEST(test_broker_gone_mid_batch);
+  RUN_TEST(test_resume_after_wake);
+  RUN_TEST(test_push_during_replay);
+  RUN_TEST(test_full_spool_drops);
+  return UNITY_END();
+}
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Build and check compressed and delta OTA firmware images.
+
+The ESP8266 Updater accepts gzip-compressed sketches on every update
+path, eboot inflates them into place on the next boot.  A delta is
+smaller still: it rebuilds the new sketch from the one running on the
+node, which must be the exact base build it was made against.
+
+    python3 tools/ota_image.py gzip   firmware.bin firmware.bin.gz
+    python3 tools/ota_image.py delta  old.bin new.bin update.delta
+    python3 tools/ota_image.py verify firmware.bin.gz [--target new.bin]
+    python3 tools/ota_image.py verify update.delta --base old.bin [--target new.bin]
+
+Upload a .bin.gz through ElegantOTA's /update page or with espota.py
+(-f firmware.bin.gz).  Upload a .delta with
+    curl -F "image=@update.delta" http://<node>/update-delta
+The delta format is described in src/delta.h.
+"""
+import argparse
+import gzip
+import hashlib
+import struct
+import sys
+
+DELTA_MAGIC = b'EDL1'
+HEADER = struct.Struct('<4sI16sI16s')
+OP_END, OP_COPY, OP_ADD = 0, 1, 2
+ESP_IMAGE_MAGIC = 0xE9
+MATCH_MIN = 16          # shortest run worth a COPY
+CANDIDATES = 8          # base positions tried per key
+
+
+def varint(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def read_varint(data, pos):
+    value = shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, pos
+
+
+def make_delta(base, target):
+    """Greedy COPY/ADD encoding of target against base."""
+    index = {}
+    for i in range(len(base) - MATCH_MIN + 1):
+        slots = index.setdefault(base[i:i + MATCH_MIN], [])
+        if len(slots) < CANDIDATES:
+            slots.append(i)
+
+    ops = bytearray()
+    literal = bytearray()
+
+    def flush_literal():
+        if literal:
+            ops.extend(bytes([OP_ADD]) + varint(len(literal)) + literal)
+            literal.clear()
+
+    i = 0
+    while i < len(target):
+        best_len, best_off = 0, 0
+        for off in index.get(target[i:i + MATCH_MIN], ()):
+            n = MATCH_MIN
+            while i + n < len(target) and off + n < len(base) and target[i + n] == base[off + n]:
+                n += 1
+            if n > best_len:
+                best_len, best_off = n, off
+        if best_len >= MATCH_MIN:
+            flush_literal()
+            ops.extend(bytes([OP_COPY]) + varint(best_off) + varint(best_len))
+            i += best_len
+        else:
+            literal.append(target[i])
+            i += 1
+    flush_literal()
+    ops.append(OP_END)
+
+    header = HEADER.pack(DELTA_MAGIC, len(base), hashlib.md5(base).digest(),
+                         len(target), hashlib.md5(target).digest())
+    return header + bytes(ops)
+
+
+def apply_delta(base, delta):
+    """Rebuild the target exactly as the node does, checking every step."""
+    magic, base_size, base_md5, target_size, target_md5 = HEADER.unpack_from(delta)
+    if magic != DELTA_MAGIC:
+        raise ValueError('not a delta image')
+    if base_size != len(base) or hashlib.md5(base).digest() != base_md5:
+        raise ValueError('delta was made for a different base image')
+    out = bytearray()
+    pos = HEADER.size
+    while True:
+        op = delta[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            off, pos = read_varint(delta, pos)
+            n, pos = read_varint(delta, pos)
+            if off + n > base_size:
+                raise ValueError('COPY outside the base image')
+            out += base[off:off + n]
+        elif op == OP_ADD:
+            n, pos = read_varint(delta, pos)
+            out += delta[pos:pos + n]
+            pos += n
+        else:
+            raise ValueError('unknown op %d at %d' % (op, pos - 1))
+        if len(out) > target_size:
+            raise ValueError('delta too long')
+    if pos != len(delta):
+        raise ValueError('data after END')
+    if len(out) != target_size or hashlib.md5(out).digest() != target_md5:
+        raise ValueError('rebuilt image does not match the target MD5')
+    return bytes(out)
+
+
+def read(path):
+    with open(path, 'rb') as f:
+        return f.read()
+
+
+def check_sketch(image, what):
+    if not image or image[0] != ESP_IMAGE_MAGIC:
+        raise ValueError('%s is not an ESP8266 sketch image' % what)
+
+
+def cmd_gzip(args):
+    image = read(args.image)
+    check_sketch(image, args.image)
+    data = gzip.compress(image, compresslevel=9, mtime=0)
+    with open(args.out, 'wb') as f:
+        f.write(data)
+    print('%s: %d -> %d bytes (%.0f%%)' % (args.out, len(image), len(data),
+                                          100.0 * len(data) / len(image)))
+
+
+def cmd_delta(args):
+    base, target = read(args.base), read(args.target)
+    check_sketch(base, args.base)
+    check_sketch(target, args.target)
+    delta = make_delta(base, target)
+    apply_delta(base, delta)        # never ship a delta that does not rebuild
+    with open(args.out, 'wb') as f:
+        f.write(delta)
+    print('%s: %d byte sketch in %d bytes (%.0f%%)' % (args.out, len(target), len(delta),
+                                                        100.0 * len(delta) / len(target)))
+
+
+def cmd_verify(args):
+    data = read(args.image)
+    if data[:4] == DELTA_MAGIC:
+        if not args.base:
+            raise ValueError('--base is needed to verify a delta')
+        image = apply_delta(read(args.base), data)
+    elif data[:2] == b'\x1f\x8b':
+        image = gzip.decompress(data)
+    else:
+        image = data
+    check_sketch(image, args.image)
+    if args.target and image != read(args.target):
+        raise ValueError('image does not match %s' % args.target)
+    print('%s: OK, %d byte sketch, md5 %s' % (args.image, len(image),
+                                               hashlib.md5(image).hexdigest()))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest='command', required=True)
+    p = sub.add_parser('gzip', help='compress a sketch image')
+    p.add_argument('image')
+    p.add_argument('out')
+    p.set_defaults(fn=cmd_gzip)
+    p = sub.add_parser('delta', help='make a delta from base to target')
+    p.add_argument('base')
+    p.add_argument('target')
+    p.add_argument('out')
+    p.set_defaults(fn=cmd_delta)
+    p = sub.add_parser('verify', help='check a .bin, .bin.gz or .delta')
+    p.add_argument('image')
+    p.add_argument('--base')
+    p.add_argument('--target')
+    p.set_defaults(fn=cmd_verify)
+    args = parser.parse_args()
+    try:
+        args.fn(args)
+    except (ValueError, OSError, IndexError, struct.error) as e:
+        print('ota_image.py: %s' % e, file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Compress the web/ assets into PROGMEM byte arrays.
+
+Every file in web/ is gzipped and written to src/web_assets.h as a
+PROGMEM array together with its content type and a strong ETag, so the
+web server can send it as-is with Content-Encoding: gzip and answer
+repeat requests with 304 Not Modified.
+
+Runs as a PlatformIO pre: extra script on every build, or by hand:
+    python3 tools/web_assets.py
+The header is only rewritten when an asset changes.
+"""
+import gzip
+import hashlib
+import mimetypes
+import os
+
+CONTENT_TYPES = {
+    '.html': 'text/html',
+    '.css': 'text/css',
+    '.js': 'application/javascript',
+    '.json': 'application/json',
+    '.svg': 'image/svg+xml',
+    '.ico': 'image/x-icon',
+}
+
+
+def c_name(name):
+    return ''.join(c if c.isalnum() else '_' for c in name) + '_gz'
+
+
+def build(project_dir):
+    web_dir = os.path.join(project_dir, 'web')
+    header = os.path.join(project_dir, 'src', 'web_assets.h')
+
+    out = ['// Generated by tools/web_assets.py from the web/ directory - do not edit',
+           '#ifndef __WEB_ASSETS_H__',
+           '#define __WEB_ASSETS_H__',
+           '',
+           '#include <Arduino.h>',
+           '',
+           'struct WebAsset {',
+           '  const char *path;           // URL the asset is served on',
+           '  const char *contentType;',
+           '  const char *etag;           // strong ETag of the gzip data',
+           '  const uint8_t *data;        // gzip data in PROGMEM',
+           '  size_t len;',
+           '};',
+           '']
+    table = []
+    for name in sorted(os.listdir(web_dir)):
+        path = os.path.join(web_dir, name)
+        if not os.path.isfile(path):
+            continue
+        with open(path, 'rb') as f:
+            raw = f.read()
+        # mtime=0 keeps the output, and so the ETag, reproducible
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        ext = os.path.splitext(name)[1]
+        ctype = CONTENT_TYPES.get(ext) or mimetypes.guess_type(name)[0] or 'application/octet-stream'
+        etag = hashlib.sha1(data).hexdigest()[:16]
+        var = c_name(name)
+        out.append('// %s: %d bytes, %d gzipped' % (name, len(raw), len(data)))
+        out.append('static const uint8_t %s[] PROGMEM = {' % var)
+        for i in range(0, len(data), 16):
+            out.append('  ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+        out.append('};')
+        out.append('')
+        url = '/' if name == 'index.html' else '/' + name
+        table.append('  { "%s", "%s", "\\"%s\\"", %s, sizeof(%s) },' % (url, ctype, etag, var, var))
+
+    out.append('static const WebAsset webAssets[] = {')
+    out.extend(table)
+    out.append('};')
+    out.append('#define WEB_ASSET_COUNT (sizeof(webAssets) / sizeof(webAssets[0]))')
+    out.append('')
+    out.append('#endif  // __WEB_ASSETS_H__')
+    text = '\n'.join(out) + '\n'
+
+    old = None
+    if os.path.exists(header):
+        with open(header) as f:
+            old = f.read()
+    if text != old:
+        with open(header, 'w') as f:
+            f.write(text)
+        print('web_assets.py: wrote %s' % header)
+
+
+try:
+    Import('env')  # noqa: F821 - defined when run by PlatformIO
+    build(env['PROJECT_DIR'])  # noqa: F821
+except NameError:
+    build(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))